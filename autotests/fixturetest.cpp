@@ -0,0 +1,264 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QtTest>
+
+#include <algorithm>
+
+#include "backend.h"
+#include "deadline.h"
+#include "drm.h"
+#include "processes.h"
+#include "sampler.h"
+#include "summary.h"
+#include "system.h"
+#include "topology.h"
+
+using namespace KAnalytics;
+
+/**
+ * The parsers run against the "workstation" fixture: one package with two
+ * cores of two threads each plus an offline Haswell CPU, an NVIDIA card driving
+ * an HDMI monitor and a laptop panel, a /proc with two processes, and a typical
+ * set of kernel tunables for a disk, an NVMe drive and a zram device
+ */
+class FixtureTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testOnlineCpus();
+    void testTopology();
+    void testDrmDisplays();
+    void testDrmGpus();
+    void testProcessMonitor();
+    void testTuning();
+    void testCpuLevel_data();
+    void testCpuLevel();
+    void testCpuFeatures();
+    void testSectionHashes();
+};
+
+static QStringList without(QStringList list, const char *name)
+{
+    list.removeAll(QLatin1String(name));
+    return list;
+}
+
+void FixtureTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true); // Summary creates a UUID in the state
+
+    FixtureBackend *backend = new FixtureBackend(QFINDTESTDATA("fixtures/workstation"));
+    QVERIFY(backend->isValid());
+    Backend::setInstance(backend);
+}
+
+void FixtureTest::cleanupTestCase()
+{
+    Backend::setInstance(0);
+}
+
+void FixtureTest::testOnlineCpus()
+{
+    QCOMPARE(Backend::instance()->processors().count(), 5);
+    QCOMPARE(Backend::instance()->onlineCpus(), 4);
+
+    // the load is divided by the fixture's CPUs, not the host's
+    Sampler sampler;
+    const Sampler::Sample sample = sampler.sample();
+    QCOMPARE(sample.loadPerCpu, 0.5f);
+    QVERIFY(qAbs(sample.memoryAvailable - 25) < 0.01);
+    QCOMPARE(sample.swapUsed, 0.0f);
+    QVERIFY(qIsNaN(sample.cpuPressure)); // no PSI in the fixture
+}
+
+void FixtureTest::testTopology()
+{
+    const Topology topology = detectTopology();
+    QCOMPARE(topology.sockets, 1);
+    QCOMPARE(topology.cores, 2);
+    QCOMPARE(topology.threads, 4);
+    QVERIFY(topology.smt);
+
+    QMap<QString, qint64> caches;
+    foreach (const CpuCache &cache, topology.caches) {
+        caches.insert(QStringLiteral("L%1 %2").arg(cache.level).arg(cache.type), cache.size);
+    }
+    QCOMPARE(caches.count(), 4);
+    QCOMPARE(caches.value(QStringLiteral("L1 Data")), Q_INT64_C(32768));
+    QCOMPARE(caches.value(QStringLiteral("L1 Instruction")), Q_INT64_C(32768));
+    QCOMPARE(caches.value(QStringLiteral("L2 Unified")), Q_INT64_C(262144));
+    QCOMPARE(caches.value(QStringLiteral("L3 Unified")), Q_INT64_C(6291456));
+
+    QCOMPARE(topology.nodeMemory, QList<qint64>() << Q_INT64_C(16314552) * 1024);
+
+    QCOMPARE(topology.hugepages.count(), 2);
+    QCOMPARE(topology.hugepages.value(Q_INT64_C(2048) * 1024), 16);
+    QCOMPARE(topology.hugepages.value(Q_INT64_C(1048576) * 1024), 0);
+}
+
+void FixtureTest::testDrmDisplays()
+{
+    QHash<QString, DrmDisplay> displays;
+    foreach (const DrmDisplay &display, drmDisplays()) {
+        displays.insert(display.connector, display);
+    }
+    QCOMPARE(displays.count(), 2); // DP-1 is disconnected
+
+    // the image size of the first detailed timing descriptor, in mm
+    const DrmDisplay hdmi = displays.value(QStringLiteral("card0-HDMI-A-1"));
+    QCOMPARE(hdmi.resolution, QSize(1920, 1080));
+    QCOMPARE(hdmi.physicalSize, QSizeF(527, 296));
+
+    // no detailed timing, the basic display parameters in cm
+    const DrmDisplay edp = displays.value(QStringLiteral("card0-eDP-1"));
+    QCOMPARE(edp.resolution, QSize(1366, 768));
+    QCOMPARE(edp.physicalSize, QSizeF(310, 170));
+
+    // the laptop panel is the primary display, although HDMI sorts before it
+    QVERIFY(edp.internal);
+    QVERIFY(!hdmi.internal);
+    QCOMPARE(drmDisplays().first().connector, QStringLiteral("card0-eDP-1"));
+
+    ScreenInfo screen;
+    QVERIFY(Backend::instance()->primaryScreen(&screen)); // no "screen" in fixture.json
+    QCOMPARE(screen.resolution, QSize(1366, 768));
+    QCOMPARE(screen.physicalSize, QSizeF(310, 170));
+    QVERIFY(screen.physicalDpi);
+}
+
+void FixtureTest::testDrmGpus()
+{
+    const QList<DrmGpu> gpus = drmGpus();
+    QCOMPARE(gpus.count(), 1);
+    QCOMPARE(gpus.first().card, QStringLiteral("card0"));
+    QCOMPARE(gpus.first().vendorId, quint16(0x10de));
+    QCOMPARE(gpus.first().deviceId, quint16(0x13c2));
+    QCOMPARE(gpus.first().vendor, QStringLiteral("NVIDIA"));
+    QCOMPARE(gpus.first().vram, Q_INT64_C(-1)); // only amdgpu reports it
+}
+
+void FixtureTest::testProcessMonitor()
+{
+    ProcessMonitor monitor(QStringList() << QStringLiteral("plasma*") << QStringLiteral("kwin_*"));
+    monitor.sample();
+
+    const QJsonObject report = monitor.toJson();
+    QCOMPARE(report.keys(), QStringList() << QStringLiteral("plasmashell"));
+    QCOMPARE(report.value(QStringLiteral("plasmashell")).toObject().value(QStringLiteral("samples")).toInt(), 1);
+}
+
+void FixtureTest::testTuning()
+{
+    const Tuning tuning = System().tuning();
+    QCOMPARE(tuning.governor, QStringLiteral("powersave"));
+    QCOMPARE(tuning.energyPerformancePreference, QStringLiteral("balance_performance"));
+    QCOMPARE(tuning.swappiness, 60);
+
+    // the selected one of several choices is in brackets
+    QCOMPARE(tuning.transparentHugepages, QStringLiteral("madvise"));
+    QCOMPARE(tuning.transparentHugepagesDefrag, QStringLiteral("madvise"));
+    QCOMPARE(tuning.ioSchedulers.value(QStringLiteral("sda")), QStringLiteral("cfq"));
+    QCOMPARE(tuning.ioSchedulers.value(QStringLiteral("nvme0n1")), QStringLiteral("none")); // the only choice, no brackets
+    QCOMPARE(tuning.ioSchedulers.count(), 2); // loop and zram devices have no interesting scheduler
+
+    QVERIFY(tuning.zswap);
+    QCOMPARE(tuning.zswapCompressor, QStringLiteral("lzo"));
+    QCOMPARE(tuning.zramDevices, 1);
+    QCOMPARE(tuning.zramSize, Q_INT64_C(4294967296));
+
+    QCOMPARE(tuning.mitigations.count(), 2);
+    QCOMPARE(tuning.mitigations.value(QStringLiteral("meltdown")), QStringLiteral("Mitigation: PTI"));
+}
+
+void FixtureTest::testCpuLevel_data()
+{
+    QTest::addColumn<QStringList>("extensions");
+    QTest::addColumn<QString>("level");
+
+    const QStringList haswell = Backend::instance()->cpuFeatures().extensions; // the fixture's
+    const QStringList v2 = QStringList() << "sse" << "sse2" << "sse3" << "ssse3" << "sse4.1" << "sse4.2" << "cx16" << "popcnt" << "lahf";
+    const QStringList avx512 = QStringList() << "avx512f" << "avx512bw" << "avx512cd" << "avx512dq" << "avx512vl";
+
+    QTest::newRow("baseline") << (QStringList() << "sse" << "sse2") << QStringLiteral("x86-64");
+    QTest::newRow("v2") << v2 << QStringLiteral("x86-64-v2");
+    QTest::newRow("v2 without lahf") << without(v2, "lahf") << QStringLiteral("x86-64");
+    QTest::newRow("haswell") << haswell << QStringLiteral("x86-64-v3");
+    QTest::newRow("haswell without movbe") << without(haswell, "movbe") << QStringLiteral("x86-64-v2");
+    QTest::newRow("skylake-x") << (haswell + avx512) << QStringLiteral("x86-64-v4");
+    QTest::newRow("avx512 only") << (v2 + avx512) << QStringLiteral("x86-64-v2"); // the levels build on each other
+}
+
+void FixtureTest::testCpuLevel()
+{
+    QFETCH(QStringList, extensions);
+    QFETCH(QString, level);
+
+    QCOMPARE(x86Level(extensions), level);
+}
+
+void FixtureTest::testCpuFeatures()
+{
+    // no level in fixture.json, it's derived like on a real x86_64 machine
+    const CpuFeatures features = Backend::instance()->cpuFeatures();
+    QCOMPARE(features.extensions.count(), 17);
+    QCOMPARE(features.level, QStringLiteral("x86-64-v3"));
+}
+
+void FixtureTest::testSectionHashes()
+{
+    const Summary summary;
+    const QStringList sections = QStringList() << QStringLiteral("system");
+    const QJsonObject report = summary.collect(Deadline(Summary::DefaultDeadline), sections);
+    QVERIFY(!report.contains("hardware"));
+    QVERIFY(!report.contains("KDE"));
+
+    const QJsonObject system = report.value("system").toObject();
+    QCOMPARE(system.value("distroName").toString(), QStringLiteral("openSUSE"));
+    const QJsonObject hashes = report.value("sectionHashes").toObject();
+    QCOMPARE(hashes.keys(), sections);
+    QCOMPARE(hashes.value("system").toString(), Summary::sectionHash(system));
+    QCOMPARE(hashes.value("system").toString().size(), 40); // hex SHA-1
+
+    // the same machine hashes the same...
+    QCOMPARE(summary.collect(Deadline(Summary::DefaultDeadline), sections).value("sectionHashes").toObject(), hashes);
+
+    // ... however the keys were inserted, and any change shows
+    QJsonObject reordered;
+    QStringList keys = system.keys();
+    std::reverse(keys.begin(), keys.end());
+    foreach (const QString &key, keys) {
+        reordered.insert(key, system.value(key));
+    }
+    QCOMPARE(Summary::sectionHash(reordered), hashes.value("system").toString());
+
+    QJsonObject changed = system;
+    changed.insert("distroVersion", QStringLiteral("42.1"));
+    QVERIFY(Summary::sectionHash(changed) != hashes.value("system").toString());
+}
+
+QTEST_GUILESS_MAIN(FixtureTest)
+
+#include "fixturetest.moc"
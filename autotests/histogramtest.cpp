@@ -0,0 +1,95 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QtTest>
+
+#include "histogram.h"
+
+using namespace KAnalytics;
+
+class HistogramTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testPercentile_data();
+    void testPercentile();
+    void testMerge();
+};
+
+void HistogramTest::testPercentile_data()
+{
+    QTest::addColumn<QVector<double> >("values");
+    QTest::addColumn<double>("p");
+    QTest::addColumn<double>("percentile");
+
+    // buckets (..1], (1..2], (2..4], (4..8] and the overflow
+    const QVector<double> values = QVector<double>() << 1 << 2 << 3 << 4 << 100;
+
+    QTest::newRow("empty") << QVector<double>() << 50.0 << 0.0;
+    QTest::newRow("minimum") << values << 0.0 << 1.0; // the first non-empty bucket
+    QTest::newRow("bound inclusive") << (QVector<double>() << 2) << 50.0 << 2.0;
+    QTest::newRow("median") << values << 50.0 << 4.0;
+    QTest::newRow("p80") << values << 80.0 << 4.0;
+    QTest::newRow("overflow") << values << 90.0 << 8.0; // the last bound, nothing better to say
+    QTest::newRow("maximum") << values << 100.0 << 8.0;
+    QTest::newRow("above 100") << values << 150.0 << 8.0;
+    QTest::newRow("below 0") << values << -10.0 << 1.0;
+    QTest::newRow("below first bound") << (QVector<double>() << -5 << 0.5) << 99.0 << 1.0;
+}
+
+void HistogramTest::testPercentile()
+{
+    QFETCH(QVector<double>, values);
+    QFETCH(double, p);
+    QFETCH(double, percentile);
+
+    Histogram histogram(QVector<double>() << 1 << 2 << 4 << 8);
+    foreach (double value, values) {
+        histogram.add(value);
+    }
+    QCOMPARE(histogram.count(), quint64(values.count()));
+    QCOMPARE(histogram.percentile(p), percentile);
+}
+
+void HistogramTest::testMerge()
+{
+    const QVector<double> bounds = QVector<double>() << 1 << 2 << 4 << 8;
+    Histogram histogram(bounds);
+    histogram.add(1, 9);
+
+    Histogram other(bounds);
+    other.add(3, 91);
+    histogram.merge(other);
+    QCOMPARE(histogram.count(), quint64(100));
+    QCOMPARE(histogram.percentile(9), 1.0);
+    QCOMPARE(histogram.percentile(10), 4.0);
+
+    // different bounds don't mix
+    Histogram coarse(QVector<double>() << 10);
+    coarse.add(5);
+    histogram.merge(coarse);
+    QCOMPARE(histogram.count(), quint64(100));
+}
+
+QTEST_GUILESS_MAIN(HistogramTest)
+
+#include "histogramtest.moc"
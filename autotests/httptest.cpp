@@ -0,0 +1,63 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QtTest>
+
+#include "http.h"
+
+using namespace KAnalytics;
+
+class HttpTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testRetryAfter_data();
+    void testRetryAfter();
+};
+
+void HttpTest::testRetryAfter_data()
+{
+    QTest::addColumn<QByteArray>("value");
+    QTest::addColumn<qint64>("delay");
+
+    QTest::newRow("empty") << QByteArray() << Q_INT64_C(-1);
+    QTest::newRow("seconds") << QByteArray("120") << Q_INT64_C(120);
+    QTest::newRow("padded") << QByteArray(" 3600 ") << Q_INT64_C(3600);
+    QTest::newRow("negative") << QByteArray("-5") << Q_INT64_C(-1);
+    QTest::newRow("garbage") << QByteArray("soon") << Q_INT64_C(-1);
+    QTest::newRow("date") << QByteArray("Wed, 21 Oct 2015 09:28:00 GMT") << Q_INT64_C(7200);
+    QTest::newRow("past date") << QByteArray("Wed, 21 Oct 2015 07:00:00 GMT") << Q_INT64_C(-1);
+    QTest::newRow("other timezone") << QByteArray("Wed, 21 Oct 2015 09:28:00 CET") << Q_INT64_C(-1);
+}
+
+void HttpTest::testRetryAfter()
+{
+    QFETCH(QByteArray, value);
+    QFETCH(qint64, delay);
+
+    const QDateTime now(QDate(2015, 10, 21), QTime(7, 28), Qt::UTC);
+    QCOMPARE(parseRetryAfter(value, now), delay);
+}
+
+QTEST_GUILESS_MAIN(HttpTest)
+
+#include "httptest.moc"
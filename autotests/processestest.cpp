@@ -0,0 +1,68 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QtTest>
+
+#include "processes.h"
+
+using namespace KAnalytics;
+
+class ProcessesTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testStatTicks_data();
+    void testStatTicks();
+};
+
+void ProcessesTest::testStatTicks_data()
+{
+    QTest::addColumn<QByteArray>("stat");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<quint64>("ticks");
+
+    QTest::newRow("bash") << QByteArray("42 (bash) S 1 42 42 34816 42 4194304 1234 0 0 0 3 1 0 0 20 0 1 0 100 12345678 1024")
+                          << true << Q_UINT64_C(4);
+    // the comm field can have both spaces and parentheses, only the last ')' ends it
+    QTest::newRow("parenthesis in comm") << QByteArray("1234 (plasma) shell) S 1 1234 1234 0 -1 4194560 52107 1201 12 0 1500 250 3 1 20 0 12 0 2121")
+                                         << true << Q_UINT64_C(1750);
+    QTest::newRow("no comm") << QByteArray("1234 plasmashell S 1") << false << Q_UINT64_C(0);
+    QTest::newRow("truncated") << QByteArray("1234 (plasmashell) S 1 1234") << false << Q_UINT64_C(0);
+    QTest::newRow("empty") << QByteArray("") << false << Q_UINT64_C(0);
+}
+
+void ProcessesTest::testStatTicks()
+{
+    QFETCH(QByteArray, stat);
+    QFETCH(bool, valid);
+    QFETCH(quint64, ticks);
+
+    quint64 parsed = 0;
+    QCOMPARE(parseStatTicks(stat.constData(), &parsed), valid);
+    if (valid) {
+        QCOMPARE(parsed, ticks);
+    }
+}
+
+QTEST_GUILESS_MAIN(ProcessesTest)
+
+#include "processestest.moc"
@@ -0,0 +1,129 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QtTest>
+
+#include "samplingpolicy.h"
+#include "state.h"
+
+using namespace KAnalytics;
+
+class SamplingPolicyTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanup();
+
+    void testNoPolicy();
+    void testRate_data();
+    void testRate();
+    void testSkipAndRefresh();
+};
+
+void SamplingPolicyTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    cleanup();
+}
+
+void SamplingPolicyTest::cleanup()
+{
+    QFile::remove(State::fileName());
+    State::instance()->reload();
+}
+
+void SamplingPolicyTest::testNoPolicy()
+{
+    const SamplingPolicy policy = SamplingPolicy::load(QDateTime::currentDateTime());
+    QVERIFY(policy.includes(0));
+    QVERIFY(policy.includes(9999));
+    QVERIFY(policy.sections().isEmpty());
+}
+
+void SamplingPolicyTest::testRate_data()
+{
+    QTest::addColumn<QByteArray>("reply");
+    QTest::addColumn<int>("firstExcluded"); // the first bucket outside the sample, 10000 for none
+
+    QTest::newRow("tenth") << QByteArray("{\"sampling\": {\"rate\": 0.1}}") << 1000;
+    QTest::newRow("nobody") << QByteArray("{\"sampling\": {\"rate\": 0}}") << 0;
+    QTest::newRow("above one") << QByteArray("{\"sampling\": {\"rate\": 2}}") << 10000;
+    QTest::newRow("below zero") << QByteArray("{\"sampling\": {\"rate\": -1}}") << 0;
+    QTest::newRow("sections only") << QByteArray("{\"sampling\": {\"sections\": [\"system\"]}}") << 10000;
+    QTest::newRow("no policy") << QByteArray("{}") << 10000;
+    QTest::newRow("not JSON") << QByteArray("<html>OK</html>") << 10000;
+}
+
+void SamplingPolicyTest::testRate()
+{
+    QFETCH(QByteArray, reply);
+    QFETCH(int, firstExcluded);
+
+    const QDateTime now = QDateTime::currentDateTime();
+    SamplingPolicy::store(reply, now);
+    const SamplingPolicy policy = SamplingPolicy::load(now);
+    if (firstExcluded > 0) {
+        QVERIFY(policy.includes(firstExcluded - 1));
+    }
+    if (firstExcluded < 10000) {
+        QVERIFY(!policy.includes(firstExcluded));
+    }
+}
+
+// A machine outside the sample never uploads, so the policy has to run out by
+// itself for it to ever hear from the server again
+void SamplingPolicyTest::testSkipAndRefresh()
+{
+    const QDateTime received(QDate(2014, 10, 1), QTime(12, 0));
+    SamplingPolicy::store("{\"sampling\": {\"rate\": 0, \"sections\": [\"system\", \"KDE\"]}}", received);
+
+    // skipped every week while it applies, it survives a restart
+    State::instance()->commit();
+    State::instance()->reload();
+    for (int week = 0; week * 7 < SamplingPolicy::MaxAge; ++week) {
+        const SamplingPolicy policy = SamplingPolicy::load(received.addDays(week * 7));
+        QVERIFY(!policy.includes(0));
+        QCOMPARE(policy.sections(), QStringList() << QStringLiteral("system") << QStringLiteral("KDE"));
+    }
+
+    // then the next export sends everything...
+    const QDateTime expired = received.addDays(SamplingPolicy::MaxAge);
+    SamplingPolicy policy = SamplingPolicy::load(expired);
+    QVERIFY(policy.includes(9999));
+    QVERIFY(policy.sections().isEmpty());
+
+    // ... and the reply to it brings the current policy
+    SamplingPolicy::store("{\"sampling\": {\"rate\": 0.5}}", expired);
+    policy = SamplingPolicy::load(expired.addDays(7));
+    QVERIFY(policy.includes(4999));
+    QVERIFY(!policy.includes(5000));
+    QVERIFY(policy.sections().isEmpty());
+
+    // a policy without a time, as stored before policies expired, is expired too
+    State::instance()->remove(QStringLiteral("samplingTime"));
+    QVERIFY(SamplingPolicy::load(expired.addDays(7)).includes(9999));
+}
+
+QTEST_GUILESS_MAIN(SamplingPolicyTest)
+
+#include "samplingpolicytest.moc"
@@ -0,0 +1,186 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <QtTest>
+#include <QDataStream>
+
+#include <KConfig>
+#include <KConfigGroup>
+
+#include "state.h"
+
+using namespace KAnalytics;
+
+/**
+ * Runs against QStandardPaths' test locations; every test starts from what it
+ * writes there itself and reloads the process wide state from it
+ */
+class StateTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanup();
+
+    void testRoundTrip();
+    void testUnreadable_data();
+    void testUnreadable();
+    void testMigration();
+};
+
+static QString configFile()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QStringLiteral("/kanalyticsrc");
+}
+
+static QByteArray stateFile(quint32 magic, quint32 version, const QVariantMap &values)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << magic << version << values;
+    return data;
+}
+
+static bool writeStateFile(const QByteArray &data)
+{
+    QDir().mkpath(QFileInfo(State::fileName()).absolutePath());
+    QFile file(State::fileName());
+    return file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(data) == data.size();
+}
+
+static QByteArray readStateFile()
+{
+    QFile file(State::fileName());
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+void StateTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    cleanup();
+}
+
+void StateTest::cleanup()
+{
+    QFile::remove(State::fileName());
+    QFile::remove(configFile());
+    State::instance()->reload();
+}
+
+void StateTest::testRoundTrip()
+{
+    State *state = State::instance();
+    QVERIFY(!state->isReadOnly());
+    QCOMPARE(state->approval(), State::NotAsked);
+
+    const QString uuid = state->uuid();
+    QVERIFY(!uuid.isEmpty());
+    QVERIFY(QFile::exists(State::fileName())); // not waiting for the commit window
+
+    const QDateTime timestamp(QDate(2014, 10, 1), QTime(12, 0));
+    state->setApproval(State::Approved);
+    state->setLastExport(timestamp);
+    state->setLastSeenPlasmaVersion(QStringLiteral("5.1.0"));
+    state->setValue(QStringLiteral("startupLogin"), QVariantList() << 0 << 3 << 1);
+    state->setValue(QStringLiteral("snapshot"), QByteArray("{}"));
+    state->remove(QStringLiteral("snapshot"));
+    QVERIFY(state->commit());
+
+    state->reload();
+    QVERIFY(!state->isReadOnly());
+    QCOMPARE(state->uuid(), uuid);
+    QCOMPARE(state->approval(), State::Approved);
+    QCOMPARE(state->lastExport(), timestamp);
+    QCOMPARE(state->lastSeenPlasmaVersion(), QStringLiteral("5.1.0"));
+    QCOMPARE(state->value(QStringLiteral("startupLogin")).toList(), QVariantList() << 0 << 3 << 1);
+    QVERIFY(!state->value(QStringLiteral("snapshot")).isValid());
+
+    // changes that weren't committed yet are gone
+    state->setLastSeenPlasmaVersion(QStringLiteral("5.2.0"));
+    state->reload();
+    QCOMPARE(state->lastSeenPlasmaVersion(), QStringLiteral("5.1.0"));
+}
+
+void StateTest::testUnreadable_data()
+{
+    QTest::addColumn<QByteArray>("contents");
+
+    QVariantMap values;
+    values.insert(QStringLiteral("uuid"), QStringLiteral("5d7a1b2c-8e4f-4a6b-9c3d-2e1f0a9b8c7d"));
+    values.insert(QStringLiteral("approval"), int(State::Approved));
+    const QByteArray valid = stateFile(0x4b415354, 1, values);
+
+    QTest::newRow("truncated") << valid.left(valid.size() - 3);
+    QTest::newRow("header only") << valid.left(8);
+    QTest::newRow("garbage") << QByteArray("[General]\nuuid=5d7a1b2c\n");
+    QTest::newRow("newer version") << stateFile(0x4b415354, 2, values);
+}
+
+void StateTest::testUnreadable()
+{
+    QFETCH(QByteArray, contents);
+    QVERIFY(writeStateFile(contents));
+
+    State *state = State::instance();
+    state->reload();
+    QVERIFY(state->isReadOnly());
+    QVERIFY(state->uuid().isEmpty()); // no made up identity
+    QCOMPARE(state->approval(), State::NotAsked);
+
+    // changes stay in memory, the file is left for somebody to look at
+    state->setApproval(State::Declined);
+    QVERIFY(!state->commit());
+    QCOMPARE(readStateFile(), contents);
+}
+
+void StateTest::testMigration()
+{
+    QDir().mkpath(QFileInfo(configFile()).absolutePath());
+    QVERIFY(QFile::copy(QFINDTESTDATA("fixtures/kanalyticsrc"), configFile()));
+    QFile::setPermissions(configFile(), QFile::ReadOwner | QFile::WriteOwner);
+
+    State *state = State::instance();
+    state->reload();
+    QVERIFY(!state->isReadOnly());
+    QCOMPARE(state->uuid(), QStringLiteral("5d7a1b2c-8e4f-4a6b-9c3d-2e1f0a9b8c7d"));
+    QCOMPARE(state->approval(), State::Approved);
+    QCOMPARE(state->lastExport(), QDateTime(QDate(2014, 10, 1), QTime(12, 0)));
+    QCOMPARE(state->lastSeenPlasmaVersion(), QStringLiteral("5.1.0"));
+    QVERIFY(QFile::exists(State::fileName()));
+
+    // the migrated groups are gone, the settings stay
+    KConfig config(configFile(), KConfig::SimpleConfig);
+    QVERIFY(!config.hasGroup("General"));
+    QVERIFY(!config.hasGroup("Export"));
+    QCOMPARE(KConfigGroup(&config, "Sampler").readEntry("Interval", 0), 30);
+
+    // from now on it's read from the state file
+    state->reload();
+    QCOMPARE(state->uuid(), QStringLiteral("5d7a1b2c-8e4f-4a6b-9c3d-2e1f0a9b8c7d"));
+    QCOMPARE(state->approval(), State::Approved);
+}
+
+QTEST_GUILESS_MAIN(StateTest)
+
+#include "statetest.moc"
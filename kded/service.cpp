@@ -20,14 +20,29 @@
 
 #include "service.h"
 #include "summary.h"
-#include "kde.h"
+#include "http.h"
+#include "samplingpolicy.h"
+#include "trace.h"
+#include "state.h"
 
 #include <QDBusConnection>
 #include <QDBusConnectionInterface>
 #include <QDBusReply>
+#include <QDBusError>
 #include <QNetworkRequest>
 #include <QDebug>
 #include <QDateTime>
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QStandardPaths>
+#include <QSet>
+#include <QtMath>
+#include <qnumeric.h>
 
 #include <KPluginFactory>
 #include <KConfigGroup>
@@ -35,17 +50,53 @@
 #include <KLocalizedString>
 
 static const uint ONE_WEEK = 7*24*60*60*1000; // 7 days * 24 hrs * 60 min * 60 sec * 1000 msec
+static const int MIN_EXPORT_INTERVAL = 60; // seconds; repeated calls within this window reuse the last result
+static const int SNAPSHOT_MAX_AGE = 60*60; // seconds; older snapshots get refreshed after being served
+static const int DEFAULT_SAMPLER_INTERVAL = 60; // seconds
+static const int DEFAULT_PROCESS_INTERVAL = 10; // seconds
+static const int LOGIN_EXPORT_SPREAD = 30*60; // seconds; overdue exports at login are spread over this window
+static const int MIN_RETRY = 5*60; // seconds; never come back sooner than this when throttled
+static const int DEFAULT_RETRY = 60*60; // seconds; first backoff when the server doesn't say, doubled on each retry
+static const int MAX_APPLICATIONS = 32; // per export, applications beyond that are ignored
+static const int MAX_APPLICATION_METRICS = 64; // counters and histograms each, per application
+static const int MAX_METRIC_NAME = 64; // characters, applies to application names too
+static const int MAX_SPOOL_SEGMENTS = 16; // reports waiting for upload; the oldest ones are dropped beyond this
+
+using KAnalytics::State;
 
 K_PLUGIN_FACTORY(KAnalyticsServiceFactory, registerPlugin<KAnalyticsService>();)
 
 KAnalyticsService::KAnalyticsService(QObject * parent, const QVariantList&)
-    : KDEDModule(parent), m_haveUserApproval(false)
+    : KDEDModule(parent), m_haveUserApproval(false), m_exportFull(true), m_fullExportQueued(false),
+      m_lastError(QNetworkReply::NoError), m_throttled(0),
+      m_snapshotRefreshPending(false),
+      m_sampler(0),
+      m_samplerTimer(0),
+      m_processMonitor(0),
+      m_processTimer(0),
+      m_startupTimes(0),
+      m_exportAttempts(0),
+      m_exportFailures(0),
+      m_exportsThrottled(0),
+      m_exportsSkipped(0),
+      m_bytesSent(0),
+      m_exportDurations(QVector<double>() << 50 << 100 << 250 << 500 << 1000 << 2500 << 5000 << 10000 << 30000 << 60000),
+      m_uploadSize(0)
 {
     connect(this, SIGNAL(moduleRegistered(QDBusObjectPath)), this, SLOT(init()));
 }
 
+// A stable per-machine offset in [0, window), so a fleet logging in at the same time
+// (or told to come back at the same time) doesn't hit the server at the same second
+static int spread(int window)
+{
+    return qHash(State::instance()->uuid()) % uint(window);
+}
+
 KAnalyticsService::~KAnalyticsService()
 {
+    delete m_sampler;
+    delete m_processMonitor;
 }
 
 void KAnalyticsService::init()
@@ -56,26 +107,43 @@ void KAnalyticsService::init()
     m_timer = new QTimer(this);
     m_timer->setTimerType(Qt::VeryCoarseTimer); // 1sec accuracy, enough for us
     connect(m_timer, &QTimer::timeout, this, &KAnalyticsService::exportData);
-    m_cfg = KSharedConfig::openConfig("kanalytics");
 
-    // read the timestamp from config
-    KConfigGroup grp(m_cfg, "Export");
-    m_timestamp = grp.readEntry<QDateTime>("Timestamp", QDateTime());
+    // the settings are only parsed if the user (or admin) actually wrote some
+    if (!QStandardPaths::locate(QStandardPaths::GenericConfigLocation, QStringLiteral("kanalyticsrc")).isEmpty()) {
+        m_settings = KSharedConfig::openConfig("kanalytics", KConfig::NoGlobals);
+    }
+
+    // read the timestamp and the last report from the state
+    State *state = State::instance();
+    if (state->isReadOnly()) { // don't ask again or export under a new identity, somebody has to look at it
+        qWarning() << "KAnalytics state unreadable, not collecting anything:" << State::fileName();
+        return;
+    }
+    m_timestamp = state->lastExport();
     //qDebug() << "Initial timestamp" << m_timestamp;
+    const QJsonObject cachedReport = QJsonDocument::fromJson(state->value(QStringLiteral("snapshot")).toByteArray()).object();
+    if (!cachedReport.isEmpty() && state->approval() == State::Approved) { // a leftover otherwise, dropped on the next refresh
+        m_snapshot = KAnalytics::Snapshot::Ptr(new KAnalytics::Snapshot(cachedReport, state->value(QStringLiteral("snapshotTime")).toDateTime()));
+    }
 
     // check if the user approved exporting data
-    m_haveUserApproval = grp.readEntry<bool>("UserApproval", false);
+    m_haveUserApproval = state->approval() == State::Approved;
     if (m_haveUserApproval) {
         //qDebug() << "We have user approval";
-        if (!m_timestamp.isValid() || m_timestamp.daysTo(QDateTime::currentDateTime()) > 7) { // no export happened yet or more than one week ago, do it now
-            //qDebug() << "EXPORTING NOW ";
-            exportData();
+        startSamplers();
+        const QDateTime retry = state->value(QStringLiteral("retryExport")).toDateTime();
+        if (retry.isValid() && retry > QDateTime::currentDateTime()) { // the server asked us to back off, still does
+            //qDebug() << "Throttled until" << retry;
+            m_timer->start(qMin<qint64>(ONE_WEEK, QDateTime::currentDateTime().msecsTo(retry)));
+        } else if (!m_timestamp.isValid() || m_timestamp.daysTo(QDateTime::currentDateTime()) > 7) { // no export happened yet or more than one week ago
+            //qDebug() << "EXPORTING SOON";
+            m_timer->start(spread(LOGIN_EXPORT_SPREAD) * 1000); // not right away, everybody logs in at 9am
         } else { // just schedule the next sync
             const int interval = qMin(ONE_WEEK, ONE_WEEK - QDateTime::currentDateTime().toTime_t()*1000 - m_timestamp.toTime_t()*1000);
             //qDebug() << "Scheduling next sync in: " << interval;
             m_timer->start(interval); // start the timer with ONE_WEEK period since the last sync, ONE_WEEK max
         }
-    } else if (!grp.hasKey("UserApproval")) { // new user, ask for approval
+    } else if (state->approval() == State::NotAsked) { // new user, ask for approval
         //qDebug() << "new user, asking for approval";
         // FIXME improve this text, link to "real info" page
         const QString text = i18n("<p>Please help us improve KDE software by giving your approval to send some "
@@ -88,18 +156,63 @@ void KAnalyticsService::init()
                                        KMessageBox::Notify | KMessageBox::AllowLink | KMessageBox::PlainCaption) == KMessageBox::Yes) {
             //qDebug() << "user agrees";
             m_haveUserApproval = true;
-            grp.writeEntry("UserApproval", true);
-            grp.sync();
+            state->setApproval(State::Approved);
+            state->commit();
+            startSamplers(true);
             exportData(); // export data
         } else {
             //qDebug() << "user disagrees";
             // FIXME perhaps we might as well disable this module completely?
-            grp.writeEntry("UserApproval", false);
-            grp.sync();
+            state->setApproval(State::Declined);
+            state->commit();
         }
     }
 }
 
+template <typename T>
+static T setting(const KSharedConfig::Ptr &settings, const char *group, const char *key, const T &defaultValue)
+{
+    if (!settings) {
+        return defaultValue;
+    }
+
+    return KConfigGroup(settings, group).readEntry<T>(key, defaultValue);
+}
+
+// @p afterConsent: started once the user answered the consent dialog, so kded's
+// load time would include however long they took to answer
+void KAnalyticsService::startSamplers(bool afterConsent)
+{
+    // has to start right away to see plasmashell come up
+    m_startupTimes = new StartupTimes(afterConsent ? StartupTimes::SkipKded : StartupTimes::MeasureAll, this);
+
+    if (setting<bool>(m_settings, "Sampler", "Enabled", true)) {
+        m_sampler = new KAnalytics::Sampler;
+        m_samplerTimer = new QTimer(this);
+        m_samplerTimer->setTimerType(Qt::VeryCoarseTimer);
+        connect(m_samplerTimer, &QTimer::timeout, this, &KAnalyticsService::recordSample);
+        m_samplerTimer->start(qMax(1, setting<int>(m_settings, "Sampler", "Interval", DEFAULT_SAMPLER_INTERVAL)) * 1000);
+    }
+
+    if (setting<bool>(m_settings, "Processes", "Enabled", true)) {
+        m_processMonitor = new KAnalytics::ProcessMonitor(setting<QStringList>(m_settings, "Processes", "Names", KAnalytics::ProcessMonitor::defaultNames()));
+        m_processTimer = new QTimer(this);
+        m_processTimer->setTimerType(Qt::VeryCoarseTimer);
+        connect(m_processTimer, &QTimer::timeout, this, &KAnalyticsService::sampleProcesses);
+        m_processTimer->start(qMax(1, setting<int>(m_settings, "Processes", "Interval", DEFAULT_PROCESS_INTERVAL)) * 1000);
+    }
+}
+
+void KAnalyticsService::recordSample()
+{
+    m_sampler->record();
+}
+
+void KAnalyticsService::sampleProcesses()
+{
+    m_processMonitor->sample();
+}
+
 QString KAnalyticsService::version() const
 {
     return KANALYTICS_VERSION;
@@ -120,31 +233,514 @@ bool KAnalyticsService::haveUserApproval() const
     return m_haveUserApproval;
 }
 
-void KAnalyticsService::exportData()
+QString KAnalyticsService::lastCollectionStats() const
+{
+    return QString::fromUtf8(m_lastCollectionStats);
+}
+
+static QNetworkRequest exportRequest(qint64 size)
 {
-    const QByteArray data = m_summary.toJson();
     QNetworkRequest request(QUrl("http://developer.kde.org/~lukas/kanalytics/kanalytics.php")); // FIXME testing page
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    request.setHeader(QNetworkRequest::ContentLengthHeader, data.size());
+    request.setHeader(QNetworkRequest::ContentLengthHeader, size);
     request.setHeader(QNetworkRequest::UserAgentHeader, QStringLiteral("KAnalytics/%1").arg(KANALYTICS_VERSION));
-    //qDebug() << "Exporting data: " << data;
-    m_manager->post(request, data);
+    return request;
+}
+
+static QString spoolPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QStringLiteral("/kanalytics/spool");
+}
+
+void KAnalyticsService::exportData()
+{
+    const bool full = calledFromDBus(); // scheduled exports follow the sampling policy
+    if (m_reply) { // already collecting and uploading, the caller gets the result of that one
+        if (full && !m_exportFull) { // ... unless it only has some of the sections
+            //qDebug() << "Sampled export in flight, queueing a full one";
+            m_fullExportQueued = true;
+        }
+        //qDebug() << "Export in flight, coalescing";
+        return;
+    }
+
+    if (m_lastAttempt.isValid() && m_lastAttempt.elapsed() < MIN_EXPORT_INTERVAL * 1000 && (m_exportFull || !full)) {
+        //qDebug() << "Export finished recently, reusing its result";
+        QMetaObject::invokeMethod(this, "emitLastResult", Qt::QueuedConnection);
+        return;
+    }
+
+    if (State::instance()->isReadOnly()) { // nothing goes out without the user's identity and answer
+        qWarning() << "KAnalytics state unreadable, not exporting:" << State::fileName();
+        if (calledFromDBus()) {
+            sendErrorReply(QDBusError::Failed, QStringLiteral("The KAnalytics state is unreadable: %1").arg(State::fileName()));
+        }
+        QMetaObject::invokeMethod(this, "exportFinished", Qt::QueuedConnection, Q_ARG(int, QNetworkReply::OperationCanceledError));
+        return;
+    }
+
+    startExport(full);
+}
+
+// Collect and upload a report; @p full: everything, regardless of the sampling policy
+void KAnalyticsService::startExport(bool full)
+{
+    m_timer->stop(); // restarted in replyFinished()
+
+    QStringList sections;
+    if (!full) {
+        const KAnalytics::SamplingPolicy policy = KAnalytics::SamplingPolicy::load(QDateTime::currentDateTime());
+        if (!policy.includes(spread(10000))) {
+            //qDebug() << "Outside the sample, skipping this export";
+            skipExport();
+            return;
+        }
+        sections = policy.sections();
+    }
+    m_exportFull = sections.isEmpty();
+
+    const KAnalytics::Snapshot::Ptr snapshot = collectSnapshot(sections);
+    if (sections.isEmpty()) { // a partial report isn't what getSnapshot() readers expect
+        publishSnapshot(snapshot);
+    } else if (!sectionsChanged(snapshot->report())) {
+        //qDebug() << "Requested sections unchanged, skipping the upload";
+        skipExport();
+        return;
+    }
+
+    m_exported = snapshot;
+    // reports are only written to disk for users who agreed, like the cached snapshot
+    m_exportedSegment = m_haveUserApproval ? spoolReport(snapshot) : QString();
+    if (!m_exportedSegment.isEmpty() && uploadNextSegment()) {
+        clearCollectors(snapshot->report()); // the data is on disk now, it gets delivered sooner or later
+    } else { // no spool, send it from memory
+        if (!m_exportedSegment.isEmpty()) {
+            QFile::remove(m_exportedSegment);
+            m_exportedSegment.clear();
+        }
+        const QByteArray data = snapshot->toJson();
+        //qDebug() << "Exporting data: " << data;
+        m_reply = m_manager->post(exportRequest(data.size()), data);
+        uploadStarted(data.size());
+        clearCollectors(snapshot->report()); // anything recorded from now on goes into the next report
+    }
+}
+
+QString KAnalyticsService::exportStats() const
+{
+    QJsonObject obj;
+    obj.insert("attempts", double(m_exportAttempts));
+    obj.insert("failures", double(m_exportFailures));
+    obj.insert("throttled", double(m_exportsThrottled));
+    obj.insert("skipped", double(m_exportsSkipped));
+    obj.insert("bytesSent", double(m_bytesSent));
+    obj.insert("durations", m_exportDurations.toJson());
+
+    qint64 spoolBytes = 0;
+    const QFileInfoList segments = QDir(spoolPath()).entryInfoList(QStringList() << QStringLiteral("*.json"), QDir::Files);
+    foreach (const QFileInfo &segment, segments) {
+        spoolBytes += segment.size();
+    }
+    obj.insert("spoolSegments", segments.count());
+    obj.insert("spoolBytes", double(spoolBytes));
+
+    return QString::fromUtf8(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+}
+
+// Write @p snapshot as a new spool segment, named so that they sort oldest first;
+// returns its path, an empty string if it couldn't be written
+QString KAnalyticsService::spoolReport(const KAnalytics::Snapshot::Ptr &snapshot) const
+{
+    QDir dir(spoolPath());
+    if (!dir.mkpath(QStringLiteral("."))) {
+        return QString();
+    }
+
+    QStringList segments = dir.entryList(QStringList() << QStringLiteral("*.json"), QDir::Files, QDir::Name);
+    while (segments.count() >= MAX_SPOOL_SEGMENTS) {
+        //qDebug() << "Spool full, dropping" << segments.first();
+        dir.remove(segments.takeFirst());
+    }
+
+    QSaveFile file(dir.filePath(QStringLiteral("%1.json").arg(QDateTime::currentMSecsSinceEpoch(), 16, 10, QLatin1Char('0'))));
+    if (!file.open(QIODevice::WriteOnly) || file.write(snapshot->toJson()) < 0 || !file.commit()) {
+        qWarning() << "Cannot spool the report to" << file.fileName() << ":" << file.errorString();
+        return QString();
+    }
+    return file.fileName();
+}
+
+// Post the oldest spool segment straight from a read-only mapping of the file; the
+// network stack reads it in chunks from there, so no copy of the payload is made
+// however large it is. Returns false if the spool is empty.
+bool KAnalyticsService::uploadNextSegment()
+{
+    const QDir dir(spoolPath());
+    foreach (const QString &segment, dir.entryList(QStringList() << QStringLiteral("*.json"), QDir::Files, QDir::Name)) {
+        QFile *file = new QFile(dir.filePath(segment));
+        if (!file->open(QIODevice::ReadOnly) || file->size() == 0) { // nothing that could ever be sent
+            qWarning() << "Dropping unreadable spool segment" << file->fileName();
+            file->remove();
+            delete file;
+            continue;
+        }
+
+        QIODevice *body = file;
+        if (uchar *data = file->map(0, file->size())) {
+            QBuffer *buffer = new QBuffer(file);
+            buffer->setData(QByteArray::fromRawData(reinterpret_cast<const char *>(data), file->size()));
+            buffer->open(QIODevice::ReadOnly);
+            body = buffer;
+        }
+
+        m_reply = m_manager->post(exportRequest(file->size()), body);
+        uploadStarted(file->size());
+        file->setParent(m_reply); // has to stay around (and mapped) until the upload is done
+        m_uploadingSegment = file->fileName();
+        return true;
+    }
+    return false;
+}
+
+void KAnalyticsService::uploadStarted(qint64 size)
+{
+    ++m_exportAttempts;
+    m_uploadSize = size;
+    m_uploadTimer.start();
+}
+
+// The samplers' data made it into @p report, start over
+void KAnalyticsService::clearCollectors(const QJsonObject &report)
+{
+    if (m_sampler && report.contains("metrics")) {
+        m_sampler->clear();
+    }
+    if (m_processMonitor && report.contains("processes")) {
+        m_processMonitor->clear();
+    }
+    if (m_startupTimes && report.contains("startup")) {
+        m_startupTimes->clear();
+    }
+    if (report.contains("applications")) {
+        m_appCounters.clear();
+        m_appLatencies.clear();
+    }
+}
+
+QString KAnalyticsService::getSnapshot(const QString &format)
+{
+    QJsonDocument::JsonFormat jsonFormat = QJsonDocument::Indented;
+    if (format == QLatin1String("compact")) {
+        jsonFormat = QJsonDocument::Compact;
+    } else if (!format.isEmpty() && format != QLatin1String("json")) {
+        if (calledFromDBus()) {
+            sendErrorReply(QDBusError::InvalidArgs, QStringLiteral("Unsupported snapshot format: %1").arg(format));
+        }
+        return QString();
+    }
+
+    // collecting runs on the main thread (Solid and QGuiApplication aren't usable from any
+    // other) and blocks the event loop while it lasts, bounded by Summary::DefaultDeadline
+    if (!m_snapshot) { // nothing collected yet, the very first reader has to wait for it
+        refreshSnapshot();
+    } else if (!m_snapshotRefreshPending && m_snapshot->timestamp().secsTo(QDateTime::currentDateTime()) > SNAPSHOT_MAX_AGE) {
+        // serve the stale one now, refresh once we're back in the event loop
+        m_snapshotRefreshPending = true;
+        QTimer::singleShot(0, this, SLOT(refreshSnapshot()));
+    }
+
+    return QString::fromUtf8(m_snapshot->toJson(jsonFormat));
+}
+
+// Application and metric names end up in the upload, keep them to identifiers like
+// "org.kde.dolphin" or "view/open-folder"
+static bool isValidMetricName(const QString &name)
+{
+    if (name.isEmpty() || name.size() > MAX_METRIC_NAME) {
+        return false;
+    }
+    foreach (const QChar &c, name) {
+        if (c.unicode() > 127 || !(c.isLetterOrNumber() || c == QLatin1Char('.') || c == QLatin1Char('_')
+                                   || c == QLatin1Char('-') || c == QLatin1Char('/') || c == QLatin1Char(':'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A count has to be a non-negative integer a double represents exactly
+static bool toCount(const QJsonValue &value, quint64 *count)
+{
+    const double d = value.toDouble(-1);
+    if (!qIsFinite(d) || d < 0 || d > 9007199254740992.0 || d != qFloor(d)) {
+        return false;
+    }
+    *count = quint64(d);
+    return true;
+}
+
+void KAnalyticsService::submitMetrics(const QString &application, const QString &json)
+{
+    if (!m_haveUserApproval || !isValidMetricName(application)) {
+        return;
+    }
+    if (!m_appCounters.contains(application) && !m_appLatencies.contains(application)
+            && QSet<QString>::fromList(m_appCounters.keys() + m_appLatencies.keys()).count() >= MAX_APPLICATIONS) {
+        qWarning() << "Too many applications submitting metrics, ignoring" << application;
+        return;
+    }
+
+    const QJsonObject obj = QJsonDocument::fromJson(json.toUtf8()).object();
+
+    const QJsonObject countersObj = obj.value("counters").toObject();
+    for (QJsonObject::const_iterator it = countersObj.constBegin(); it != countersObj.constEnd(); ++it) {
+        quint64 count;
+        if (!isValidMetricName(it.key()) || !toCount(it.value(), &count)) {
+            continue;
+        }
+        QHash<QString, quint64> &counters = m_appCounters[application];
+        if (!counters.contains(it.key()) && counters.count() >= MAX_APPLICATION_METRICS) {
+            continue;
+        }
+        counters[it.key()] += count;
+    }
+
+    const QJsonObject latenciesObj = obj.value("latencies").toObject();
+    for (QJsonObject::const_iterator it = latenciesObj.constBegin(); it != latenciesObj.constEnd(); ++it) {
+        if (!isValidMetricName(it.key())) {
+            continue;
+        }
+        QVector<quint64> counts;
+        foreach (const QJsonValue &value, it.value().toArray()) {
+            quint64 count;
+            if (!toCount(value, &count)) {
+                counts.clear();
+                break;
+            }
+            counts.append(count);
+        }
+        KAnalytics::Histogram submitted(KAnalytics::LatencyHistogram::bounds());
+        submitted.setCounts(counts); // ignored if the size doesn't match
+        if (!submitted.count()) {
+            continue;
+        }
+        QHash<QString, KAnalytics::Histogram> &latencies = m_appLatencies[application];
+        if (!latencies.contains(it.key())) {
+            if (latencies.count() >= MAX_APPLICATION_METRICS) {
+                continue;
+            }
+            latencies.insert(it.key(), KAnalytics::Histogram(KAnalytics::LatencyHistogram::bounds()));
+        }
+        latencies[it.key()].merge(submitted);
+    }
+}
+
+void KAnalyticsService::refreshSnapshot()
+{
+    m_snapshotRefreshPending = false;
+    publishSnapshot(collectSnapshot());
+}
+
+// The export the server doesn't need this time. It isn't an attempt: an explicit
+// exportData() right after it still has to upload instead of reusing a result
+void KAnalyticsService::skipExport()
+{
+    ++m_exportsSkipped;
+    m_timer->start(ONE_WEEK);
+    QMetaObject::invokeMethod(this, "exportFinished", Qt::QueuedConnection, Q_ARG(int, QNetworkReply::NoError));
+}
+
+// Whether @p report has anything the last successful export didn't; only the sections
+// with a content hash can be compared, any other section counts as changed
+bool KAnalyticsService::sectionsChanged(const QJsonObject &report) const
+{
+    const QJsonObject hashes = report.value("sectionHashes").toObject();
+    const QVariantMap sent = State::instance()->value(QStringLiteral("sentSectionHashes")).toMap();
+    for (QJsonObject::const_iterator it = report.constBegin(); it != report.constEnd(); ++it) {
+        if (it.key() == "uuid" || it.key() == "sectionHashes" || it.key() == "missing") {
+            continue;
+        }
+        if (!hashes.contains(it.key()) || sent.value(it.key()).toString() != hashes.value(it.key()).toString()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+KAnalytics::Snapshot::Ptr KAnalyticsService::collectSnapshot(const QStringList &sections)
+{
+    KAnalytics::Trace trace;
+    QJsonObject report = m_summary.collect(KAnalytics::Deadline(KAnalytics::Summary::DefaultDeadline), sections);
+    if (m_sampler && (sections.isEmpty() || sections.contains("metrics"))) {
+        report.insert("metrics", m_sampler->toJson());
+    }
+    if (m_processMonitor && (sections.isEmpty() || sections.contains("processes"))) {
+        report.insert("processes", m_processMonitor->toJson());
+    }
+    if (m_startupTimes && (sections.isEmpty() || sections.contains("startup"))) {
+        report.insert("startup", m_startupTimes->toJson());
+    }
+    if ((!m_appCounters.isEmpty() || !m_appLatencies.isEmpty()) && (sections.isEmpty() || sections.contains("applications"))) {
+        report.insert("applications", applicationsToJson());
+    }
+    const KAnalytics::Snapshot::Ptr snapshot(new KAnalytics::Snapshot(report));
+    m_lastCollectionStats = QJsonDocument(trace.toStats()).toJson(QJsonDocument::Compact);
+    return snapshot;
+}
+
+void KAnalyticsService::publishSnapshot(const KAnalytics::Snapshot::Ptr &snapshot)
+{
+    m_snapshot = snapshot;
+
+    // keep it around for getSnapshot() callers after a restart, but only write
+    // the report to disk for users who agreed to have it collected
+    State *state = State::instance();
+    if (m_haveUserApproval) {
+        state->setValue(QStringLiteral("snapshot"), snapshot->toJson(QJsonDocument::Compact));
+        state->setValue(QStringLiteral("snapshotTime"), snapshot->timestamp());
+    } else {
+        state->remove(QStringLiteral("snapshot"));
+        state->remove(QStringLiteral("snapshotTime"));
+    }
+}
+
+QJsonObject KAnalyticsService::applicationsToJson() const
+{
+    QJsonObject obj;
+
+    QHash<QString, QHash<QString, quint64> >::const_iterator app;
+    for (app = m_appCounters.constBegin(); app != m_appCounters.constEnd(); ++app) {
+        QJsonObject counters;
+        QHash<QString, quint64>::const_iterator it;
+        for (it = app->constBegin(); it != app->constEnd(); ++it) {
+            counters.insert(it.key(), double(it.value()));
+        }
+        QJsonObject appObj;
+        appObj.insert("counters", counters);
+        obj.insert(app.key(), appObj);
+    }
+
+    QHash<QString, QHash<QString, KAnalytics::Histogram> >::const_iterator latencyApp;
+    for (latencyApp = m_appLatencies.constBegin(); latencyApp != m_appLatencies.constEnd(); ++latencyApp) {
+        QJsonObject latencies; // in nanoseconds
+        QHash<QString, KAnalytics::Histogram>::const_iterator it;
+        for (it = latencyApp->constBegin(); it != latencyApp->constEnd(); ++it) {
+            QJsonObject histObj;
+            histObj.insert("count", double(it->count()));
+            histObj.insert("p50", it->percentile(50));
+            histObj.insert("p90", it->percentile(90));
+            histObj.insert("p99", it->percentile(99));
+            latencies.insert(it.key(), histObj);
+        }
+        QJsonObject appObj = obj.value(latencyApp.key()).toObject();
+        appObj.insert("latencies", latencies);
+        obj.insert(latencyApp.key(), appObj);
+    }
+
+    return obj;
+}
+
+void KAnalyticsService::emitLastResult()
+{
+    Q_EMIT exportFinished(m_lastError);
+}
+
+// How long to wait before trying again after the server turned an export away as
+// overloaded: its Retry-After (delay-seconds or an HTTP-date) if it sent one, an
+// exponential backoff otherwise; spread out per machine in both cases
+int KAnalyticsService::retryInterval(QNetworkReply *reply) const
+{
+    qint64 secs = parseRetryAfter(reply->rawHeader("Retry-After"), QDateTime::currentDateTimeUtc());
+    if (secs < 0) {
+        secs = qint64(DEFAULT_RETRY) << qMin(m_throttled - 1, 7);
+    }
+
+    secs = qMax<qint64>(secs, MIN_RETRY);
+    secs += spread(qMax<qint64>(MIN_RETRY, secs / 10));
+    return qMin<qint64>(secs * 1000, ONE_WEEK);
 }
 
 void KAnalyticsService::replyFinished(QNetworkReply *reply)
 {
     //qDebug() << "Sending data finished: " << reply->error() << " with msg: " << reply->errorString();
+    m_exportDurations.add(m_uploadTimer.elapsed());
+    if (reply->error() == QNetworkReply::NoError) {
+        m_bytesSent += m_uploadSize;
+    } else {
+        ++m_exportFailures;
+    }
+
+    const bool current = m_uploadingSegment == m_exportedSegment; // not a leftover of an earlier export
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    // a client error other than a timeout or throttling won't go away by sending the same
+    // segment again, don't let it hold up everything spooled after it
+    const bool rejected = status >= 400 && status < 500 && status != 408 && status != 429;
+    if (rejected && !m_uploadingSegment.isEmpty()) {
+        qWarning() << "Server rejected spooled report" << m_uploadingSegment << "with" << status << ", dropping it";
+        QFile::remove(m_uploadingSegment);
+    }
+
     if (reply->error() == QNetworkReply::NoError) { // set and write timestamp and last seen Plasma version
-        m_timestamp = QDateTime::currentDateTime();
-        KConfigGroup grp(m_cfg, "Export");
-        grp.writeEntry("Timestamp", m_timestamp);
-        KAnalytics::KDE k;
-        grp.writeEntry("LastSeenPlasmaVersion", k.plasmaVersion());
-        grp.sync();
-    }
-    m_timer->start(ONE_WEEK); // restart the timer with one week period
-    Q_EMIT exportFinished(reply->error());
+        // all of these land in the state's same commit window, i.e. one write
+        State *state = State::instance();
+        if (!m_uploadingSegment.isEmpty()) {
+            QFile::remove(m_uploadingSegment);
+        }
+
+        if (current) {
+            m_timestamp = QDateTime::currentDateTime();
+            state->setLastExport(m_timestamp);
+            const QJsonObject report = m_exported->report();
+            if (report.contains("KDE")) {
+                state->setLastSeenPlasmaVersion(report.value("KDE").toObject().value("plasmaVersion").toString());
+            }
+
+            // remember what the server has, so that unchanged sections needn't be sent again
+            QVariantMap sent = state->value(QStringLiteral("sentSectionHashes")).toMap();
+            const QJsonObject hashes = report.value("sectionHashes").toObject();
+            for (QJsonObject::const_iterator it = hashes.constBegin(); it != hashes.constEnd(); ++it) {
+                sent.insert(it.key(), it.value().toString());
+            }
+            state->setValue(QStringLiteral("sentSectionHashes"), sent);
+        }
+
+        KAnalytics::SamplingPolicy::store(reply->readAll(), QDateTime::currentDateTime());
+    }
+    m_uploadingSegment.clear();
+    m_reply = 0;
     reply->deleteLater();
+
+    // go on with the rest of the spool, oldest first, one segment at a time
+    if ((reply->error() == QNetworkReply::NoError || rejected) && uploadNextSegment()) {
+        return;
+    }
+
+    m_exported.clear();
+    m_exportedSegment.clear();
+
+    if (status == 429 || status == 503) { // overloaded, come back when the server says so
+        ++m_throttled;
+        ++m_exportsThrottled;
+        const int interval = retryInterval(reply);
+        //qDebug() << "Throttled, retrying in" << interval;
+        State::instance()->setValue(QStringLiteral("retryExport"), QDateTime::currentDateTime().addMSecs(interval));
+        m_timer->start(interval);
+    } else {
+        m_throttled = 0;
+        State::instance()->remove(QStringLiteral("retryExport"));
+        m_timer->start(ONE_WEEK); // restart the timer with one week period
+    }
+    m_lastAttempt.start();
+    m_lastError = reply->error();
+    Q_EMIT exportFinished(m_lastError);
+
+    if (m_fullExportQueued) { // asked for over D-Bus while a sampled export was in flight
+        m_fullExportQueued = false;
+        if (status != 429 && status != 503) { // otherwise the caller got the server's answer above
+            startExport(true);
+        }
+    }
 }
 
 #include "service.moc"
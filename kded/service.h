@@ -24,19 +24,30 @@
 #include <QNetworkReply>
 #include <QTimer>
 #include <QNetworkAccessManager>
+#include <QPointer>
+#include <QDBusContext>
+#include <QHash>
+#include <QElapsedTimer>
 
 #include <KDEDModule>
 #include <KSharedConfig>
 
 #include "summary.h"
+#include "snapshot.h"
+#include "sampler.h"
+#include "processes.h"
+#include "startuptimes.h"
+#include "metrics.h"
 
-class Q_DECL_EXPORT KAnalyticsService : public KDEDModule
+class Q_DECL_EXPORT KAnalyticsService : public KDEDModule, protected QDBusContext
 {
     Q_CLASSINFO("D-Bus Interface", "org.kde.analytics")
     Q_PROPERTY(QString version READ version SCRIPTABLE true)
     Q_PROPERTY(QString uuid READ uuid SCRIPTABLE true)
     Q_PROPERTY(uint timestamp READ timestamp SCRIPTABLE true)
     Q_PROPERTY(bool haveUserApproval READ haveUserApproval SCRIPTABLE true)
+    Q_PROPERTY(QString lastCollectionStats READ lastCollectionStats SCRIPTABLE true)
+    Q_PROPERTY(QString exportStats READ exportStats SCRIPTABLE true)
     Q_OBJECT
 public:
     KAnalyticsService(QObject * parent, const QVariantList&);
@@ -64,15 +75,72 @@ public:
      */
     bool haveUserApproval() const;
 
+    /**
+     * @return timings of the last collection as compact JSON: the total time and,
+     * per collector and probe, the duration (both in microseconds)
+     *
+     * @see KAnalytics::Trace::toStats()
+     */
+    QString lastCollectionStats() const;
+
+    /**
+     * @return the health of the uploads since the module was loaded, as compact JSON:
+     * "attempts", "failures", "throttled" and "skipped" exports, "bytesSent",
+     * the upload "durations" histogram (in milliseconds) and the reports still
+     * waiting in the spool ("spoolSegments", "spoolBytes")
+     */
+    QString exportStats() const;
+
 public Q_SLOTS:
     /**
       * Send the analytics data unconditionally to a KDE server using the JSON format.
       *
-      * Emits the signal exportFinished(), writes the timestamp to the config file upon
+      * Emits the signal exportFinished(), records the timestamp in the KAnalytics state upon
       * successful completion
+      *
+      * Calls made while an export is already in flight are coalesced into it, calls made
+      * shortly after an export finished get its result without collecting or uploading again;
+      * in both cases every caller receives the same exportFinished() result. A call over D-Bus
+      * is only coalesced into (or answered by) a full export, a full one follows a sampled
+      * export still in flight.
+      *
+      * Scheduled exports follow the sampling policy the server sent with its last reply:
+      * machines outside the sample rate skip the run, the others only collect the requested
+      * sections and don't upload if those are unchanged since the last export. A policy
+      * older than four weeks no longer applies, the next export then sends everything and
+      * picks up the current one. Calls over D-Bus always export everything.
+      *
+      * Nothing is collected or sent while the KAnalytics state is unreadable, the call
+      * fails and exportFinished() reports QNetworkReply::OperationCanceledError.
       */
     Q_SCRIPTABLE void exportData();
 
+    /**
+     * Return the most recently collected analytics data without collecting it again.
+     *
+     * The report is served from memory; if it is older than an hour it is still returned
+     * and a fresh one is collected afterwards for subsequent callers. Only the very first
+     * call, before anything was collected, waits for the collection. It is only kept on
+     * disk across restarts if the user approved collecting data.
+     *
+     * @param format either "json" (the default when empty) or "compact" for single-line JSON
+     * @return the report in the requested format
+     */
+    Q_SCRIPTABLE QString getSnapshot(const QString &format);
+
+    /**
+     * Merge the counters and latency histograms an application recorded into the
+     * next export; called by KAnalytics::Metrics::flush()
+     *
+     * @param application the application's name
+     * @param json the "counters" (name -> count) and "latencies" (name -> bucket counts)
+     * recorded since the application's last call, as JSON
+     *
+     * Names must be short ASCII identifiers and counts non-negative integers, anything
+     * else is dropped; so are applications and metrics beyond a fixed number per export.
+     */
+    Q_SCRIPTABLE void submitMetrics(const QString &application, const QString &json);
+
 Q_SIGNALS:
     /**
      * Emitted when the data has (not) been exported
@@ -85,14 +153,58 @@ Q_SIGNALS:
 private Q_SLOTS:
     void init();
     void replyFinished(QNetworkReply* reply);
+    void emitLastResult();
+    void refreshSnapshot();
+    void recordSample();
+    void sampleProcesses();
 
 private:
+    void startSamplers(bool afterConsent = false);
+    KAnalytics::Snapshot::Ptr collectSnapshot(const QStringList &sections = QStringList());
+    QJsonObject applicationsToJson() const;
+    void publishSnapshot(const KAnalytics::Snapshot::Ptr &snapshot);
+    int retryInterval(QNetworkReply *reply) const;
+    void startExport(bool full);
+    void skipExport();
+    QString spoolReport(const KAnalytics::Snapshot::Ptr &snapshot) const;
+    bool uploadNextSegment();
+    void clearCollectors(const QJsonObject &report);
+    void uploadStarted(qint64 size);
+    bool sectionsChanged(const QJsonObject &report) const;
+
     QTimer * m_timer;
     QNetworkAccessManager *m_manager;
     KAnalytics::Summary m_summary;
     QDateTime m_timestamp;
-    KSharedConfig::Ptr m_cfg;
+    KSharedConfig::Ptr m_settings; // null if there's no kanalyticsrc
     bool m_haveUserApproval;
+    QPointer<QNetworkReply> m_reply; // the export currently in flight, if any
+    KAnalytics::Snapshot::Ptr m_exported; // the report collected by the export in flight
+    QString m_exportedSegment; // its spool segment, empty if it couldn't be spooled
+    QString m_uploadingSegment; // the spool segment m_reply is uploading
+    bool m_exportFull; // whether the export in flight, or the last one, has all the sections
+    bool m_fullExportQueued; // a D-Bus caller is waiting for a full export after the sampled one in flight
+    QElapsedTimer m_lastAttempt; // since the last export finished, monotonic so clock changes can't extend the window
+    int m_lastError;
+    int m_throttled; // consecutive exports the server turned away with 429/503
+    KAnalytics::Snapshot::Ptr m_snapshot; // served by getSnapshot(), only touched on the main thread
+    bool m_snapshotRefreshPending;
+    QByteArray m_lastCollectionStats;
+    KAnalytics::Sampler *m_sampler; // 0 unless enabled and the user approved
+    QTimer *m_samplerTimer;
+    KAnalytics::ProcessMonitor *m_processMonitor; // 0 unless enabled and the user approved
+    QTimer *m_processTimer;
+    StartupTimes *m_startupTimes; // 0 unless the user approved
+    QHash<QString, QHash<QString, quint64> > m_appCounters; // application -> counter name -> count
+    QHash<QString, QHash<QString, KAnalytics::Histogram> > m_appLatencies; // application -> histogram name -> histogram
+    quint64 m_exportAttempts; // uploads started, spool catch-up included
+    quint64 m_exportFailures;
+    quint64 m_exportsThrottled;
+    quint64 m_exportsSkipped; // left out by the sampling policy
+    quint64 m_bytesSent;
+    KAnalytics::Histogram m_exportDurations; // msec
+    QElapsedTimer m_uploadTimer;
+    qint64 m_uploadSize;
 };
 
 #endif // KANALYTICS_KDED_SERVICE_H
@@ -0,0 +1,209 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of
+    the License or (at your option) version 3 or any later version
+    accepted by the membership of KDE e.V. (or its successor approved
+    by the membership of KDE e.V.), which shall act as a proxy
+    defined in Section 14 of version 3 of the license.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "startuptimes.h"
+#include "sysfs.h"
+#include "state.h"
+
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusServiceWatcher>
+#include <QDBusVariant>
+#include <QTimer>
+
+#include <time.h>
+#include <unistd.h>
+
+static const QString plasmaService = QStringLiteral("org.kde.plasmashell");
+static const int PLASMA_TIMEOUT = 5*60*1000; // msec; a login taking longer than this isn't a normal login
+static const int DBUS_TIMEOUT = 2000; // msec
+
+static qint64 now(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+static QVector<double> loginBounds()
+{
+    return QVector<double>() << 2000 << 4000 << 6000 << 8000 << 10000 << 15000 << 20000 << 30000 << 60000;
+}
+
+static QVector<double> kdedBounds()
+{
+    return QVector<double>() << 100 << 250 << 500 << 1000 << 2500 << 5000 << 10000;
+}
+
+// Properties.Get @p property of @p interface, asynchronously; @p func gets the value
+template <typename Func>
+static void getProperty(const QDBusConnection &bus, QObject *context, const QString &service, const QString &path,
+                        const QString &interface, const QString &property, Func func)
+{
+    QDBusMessage msg = QDBusMessage::createMethodCall(service, path, QStringLiteral("org.freedesktop.DBus.Properties"), QStringLiteral("Get"));
+    msg << interface << property;
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(bus.asyncCall(msg, DBUS_TIMEOUT), context);
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, context, [watcher, func]() {
+        const QDBusPendingReply<QDBusVariant> reply = *watcher;
+        if (!reply.isError()) {
+            func(reply.value().variant());
+        }
+        watcher->deleteLater();
+    });
+}
+
+StartupTimes::StartupTimes(Mode mode, QObject *parent)
+    : QObject(parent), m_watcher(0), m_sessionStart(-1), m_plasmaReady(-1),
+      m_login(loginBounds()), m_kded(kdedBounds()), m_userManager(loginBounds())
+{
+    load();
+
+    // kded's start time, field 22 of /proc/self/stat, in clock ticks since boot
+    const QByteArray stat = mode == SkipKded ? QByteArray() : KAnalytics::readSysFile(QStringLiteral("/proc/self/stat"), 1024);
+    const QList<QByteArray> fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+    if (fields.size() > 19) {
+        const qint64 started = fields.at(19).toLongLong() * 1000000 / sysconf(_SC_CLK_TCK);
+        m_kded.add((now(CLOCK_BOOTTIME) - started) / 1000);
+    }
+
+    if (QDBusConnection::sessionBus().interface()->isServiceRegistered(plasmaService)) {
+        // kded got restarted or loaded us late, there's no login to measure
+        save();
+    } else {
+        m_watcher = new QDBusServiceWatcher(plasmaService, QDBusConnection::sessionBus(), QDBusServiceWatcher::WatchForRegistration, this);
+        connect(m_watcher, &QDBusServiceWatcher::serviceRegistered, this, &StartupTimes::plasmaRegistered);
+        QTimer::singleShot(PLASMA_TIMEOUT, this, SLOT(giveUp()));
+        querySessionStart();
+    }
+
+    queryUserManager();
+}
+
+void StartupTimes::querySessionStart()
+{
+    getProperty(QDBusConnection::systemBus(), this, QStringLiteral("org.freedesktop.login1"), QStringLiteral("/org/freedesktop/login1/session/self"),
+                QStringLiteral("org.freedesktop.login1.Session"), QStringLiteral("TimestampMonotonic"), [this](const QVariant &value) {
+        m_sessionStart = value.toLongLong();
+        maybeRecordLogin();
+    });
+}
+
+void StartupTimes::queryUserManager()
+{
+    const QString service = QStringLiteral("org.freedesktop.systemd1");
+    const QString path = QStringLiteral("/org/freedesktop/systemd1");
+    const QString interface = QStringLiteral("org.freedesktop.systemd1.Manager");
+    getProperty(QDBusConnection::sessionBus(), this, service, path, interface, QStringLiteral("UserspaceTimestampMonotonic"), [=](const QVariant &userspace) {
+        getProperty(QDBusConnection::sessionBus(), this, service, path, interface, QStringLiteral("FinishTimestampMonotonic"), [=](const QVariant &finish) {
+            const qint64 start = userspace.toLongLong();
+            const qint64 end = finish.toLongLong();
+            if (start <= 0 || end <= start) { // 0 while the manager is still starting up
+                return;
+            }
+
+            // the same manager outlives kded restarts, count each of its startups once
+            const QString startup = QString::fromLatin1(KAnalytics::readSysFile(QStringLiteral("/proc/sys/kernel/random/boot_id"))) + QLatin1Char(':') + QString::number(start);
+            KAnalytics::State *state = KAnalytics::State::instance();
+            if (state->value(QStringLiteral("startupUserManagerSeen")).toString() == startup) {
+                return;
+            }
+            state->setValue(QStringLiteral("startupUserManagerSeen"), startup);
+            m_userManager.add((end - start) / 1000);
+            save();
+        });
+    });
+}
+
+void StartupTimes::plasmaRegistered()
+{
+    m_plasmaReady = now(CLOCK_MONOTONIC);
+    maybeRecordLogin();
+}
+
+void StartupTimes::maybeRecordLogin()
+{
+    if (m_sessionStart <= 0 || m_plasmaReady < 0) {
+        return;
+    }
+
+    if (m_plasmaReady > m_sessionStart) {
+        m_login.add((m_plasmaReady - m_sessionStart) / 1000);
+    }
+    giveUp();
+}
+
+void StartupTimes::giveUp()
+{
+    delete m_watcher;
+    m_watcher = 0;
+    save();
+}
+
+QJsonObject StartupTimes::toJson() const
+{
+    QJsonObject obj;
+    obj.insert("login", m_login.toJson());
+    obj.insert("kded", m_kded.toJson());
+    obj.insert("userManager", m_userManager.toJson());
+    return obj;
+}
+
+void StartupTimes::clear()
+{
+    m_login.clear();
+    m_kded.clear();
+    m_userManager.clear();
+    save();
+}
+
+static QVector<quint64> readCounts(const QString &key)
+{
+    QVector<quint64> counts;
+    foreach (const QVariant &count, KAnalytics::State::instance()->value(key).toList()) {
+        counts.append(count.toULongLong());
+    }
+    return counts;
+}
+
+static void writeCounts(const QString &key, const KAnalytics::Histogram &histogram)
+{
+    QVariantList counts;
+    foreach (quint64 count, histogram.counts()) {
+        counts.append(count);
+    }
+    KAnalytics::State::instance()->setValue(key, counts);
+}
+
+void StartupTimes::load()
+{
+    m_login.setCounts(readCounts(QStringLiteral("startupLogin")));
+    m_kded.setCounts(readCounts(QStringLiteral("startupKded")));
+    m_userManager.setCounts(readCounts(QStringLiteral("startupUserManager")));
+}
+
+void StartupTimes::save()
+{
+    writeCounts(QStringLiteral("startupLogin"), m_login);
+    writeCounts(QStringLiteral("startupKded"), m_kded);
+    writeCounts(QStringLiteral("startupUserManager"), m_userManager);
+}
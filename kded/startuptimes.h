@@ -0,0 +1,83 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of
+    the License or (at your option) version 3 or any later version
+    accepted by the membership of KDE e.V. (or its successor approved
+    by the membership of KDE e.V.), which shall act as a proxy
+    defined in Section 14 of version 3 of the license.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef KANALYTICS_KDED_STARTUPTIMES_H
+#define KANALYTICS_KDED_STARTUPTIMES_H
+
+#include <QObject>
+#include <QJsonObject>
+
+#include "histogram.h"
+
+class QDBusServiceWatcher;
+
+/**
+ * Session startup timing
+ *
+ * Measures how long this login took, from logind creating the session (i.e. the
+ * display manager handing over) until plasmashell shows up on the session bus,
+ * how long kded took to load this module, and how long the systemd user manager
+ * took to start up. All times are taken from CLOCK_MONOTONIC (CLOCK_BOOTTIME for
+ * kded, as that's what /proc reports the process start in).
+ *
+ * Each login's times are added to per-machine histograms that persist across
+ * logins until they are exported.
+ */
+class StartupTimes : public QObject
+{
+    Q_OBJECT
+public:
+    enum Mode {
+        MeasureAll,
+        SkipKded ///< kded's start is too long ago to say anything about loading this module
+    };
+
+    explicit StartupTimes(Mode mode = MeasureAll, QObject *parent = 0);
+
+    /**
+     * @return the startup time histograms as a QJsonObject
+     */
+    QJsonObject toJson() const;
+
+    /**
+     * Drop the recorded histograms, e.g. after they were exported
+     */
+    void clear();
+
+private Q_SLOTS:
+    void plasmaRegistered();
+    void giveUp();
+
+private:
+    void querySessionStart();
+    void queryUserManager();
+    void maybeRecordLogin();
+    void load();
+    void save();
+
+    QDBusServiceWatcher *m_watcher;
+    qint64 m_sessionStart; // usec, CLOCK_MONOTONIC, -1 until known
+    qint64 m_plasmaReady;  // usec, CLOCK_MONOTONIC, -1 until known
+    KAnalytics::Histogram m_login;
+    KAnalytics::Histogram m_kded;
+    KAnalytics::Histogram m_userManager;
+};
+
+#endif // KANALYTICS_KDED_STARTUPTIMES_H
@@ -0,0 +1,365 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusError>
+#include <QDBusMessage>
+#include <QDBusVariant>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QScreen>
+#include <QDebug>
+
+#include <Solid/Device>
+#include <Solid/GenericInterface>
+#include <Solid/Processor>
+#include <Solid/StorageDrive>
+
+#ifdef Q_OS_LINUX
+#include <sys/sysinfo.h>
+#endif
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include "backend.h"
+#include "drm.h"
+
+using namespace KAnalytics;
+
+static const QString hostname1Service = QStringLiteral("org.freedesktop.hostname1");
+
+static Backend *s_backend = 0;
+
+// The primary screen from DRM/EDID data in sysfs, for when there's no QScreen
+static bool drmScreen(ScreenInfo *screen)
+{
+    const QList<DrmDisplay> displays = drmDisplays();
+    if (displays.isEmpty()) {
+        return false;
+    }
+    const DrmDisplay &display = displays.first();
+    screen->resolution = display.resolution;
+    screen->physicalSize = display.physicalSize;
+    // there's no logical DPI without a platform plugin, report the physical one
+    screen->dpi = (display.physicalSize.width() > 0 && display.resolution.width() > 0) ? display.resolution.width() * 25.4 / display.physicalSize.width() : 0;
+    screen->physicalDpi = true;
+    return true;
+}
+
+static bool isGuiApplication()
+{
+    return qobject_cast<QGuiApplication *>(QCoreApplication::instance());
+}
+
+Backend::~Backend()
+{
+}
+
+QString Backend::rootPath() const
+{
+    return QString();
+}
+
+QList<ProcessorInfo> Backend::processors() const
+{
+    QList<ProcessorInfo> processors;
+    foreach (const Solid::Device &device, Solid::Device::listFromType(Solid::DeviceInterface::Processor)) {
+        ProcessorInfo info;
+        info.vendor = device.vendor();
+        info.product = device.product();
+        const Solid::Processor *proc = device.as<Solid::Processor>();
+        info.maxSpeed = proc ? proc->maxSpeed() : 0;
+        processors.append(info);
+    }
+    return processors;
+}
+
+int Backend::onlineCpus() const
+{
+    return int(qMax(1L, sysconf(_SC_NPROCESSORS_ONLN)));
+}
+
+QList<DriveInfo> Backend::drives() const
+{
+    QList<DriveInfo> drives;
+    foreach (Solid::Device device, Solid::Device::listFromType(Solid::DeviceInterface::StorageDrive)) {
+        Solid::StorageDrive * drive = device.as<Solid::StorageDrive>();
+        if (!drive || drive->driveType() != Solid::StorageDrive::HardDisk) { // not interested in optical drives and such
+            continue;
+        }
+        Solid::GenericInterface * genIface = device.as<Solid::GenericInterface>();
+        DriveInfo info;
+        info.rotationRate = genIface ? genIface->property("RotationRate").toInt() : -1;
+        //qDebug() << "Drive " << device.udi() << " rate: " << info.rotationRate;
+        drives.append(info);
+    }
+    return drives;
+}
+
+QString Backend::chassis(int timeout, Deadline::Reason *failure) const
+{
+    // a plain Properties.Get activates hostnamed on demand, and unlike QDBusInterface
+    // it doesn't need a (blocking, untimed) introspection call first
+    QDBusMessage msg = QDBusMessage::createMethodCall(hostname1Service, QStringLiteral("/org/freedesktop/hostname1"),
+                                                      QStringLiteral("org.freedesktop.DBus.Properties"), QStringLiteral("Get"));
+    msg << hostname1Service << QStringLiteral("Chassis");
+    const QDBusMessage reply = QDBusConnection::systemBus().call(msg, QDBus::Block, timeout);
+    if (reply.type() == QDBusMessage::ReplyMessage && !reply.arguments().isEmpty()) {
+        return reply.arguments().first().value<QDBusVariant>().variant().toString();
+    }
+
+    if (failure) {
+        const QDBusError::ErrorType error = QDBusError(reply).type();
+        *failure = (error == QDBusError::NoReply || error == QDBusError::Timeout) ? Deadline::TimedOut : Deadline::Unavailable;
+    }
+    return QString();
+}
+
+bool Backend::kernel(KernelInfo *info) const
+{
+    struct utsname utsName;
+    if (uname(&utsName) == -1) {
+        return false;
+    }
+
+    info->name = QString::fromLatin1(utsName.sysname);
+    info->release = QString::fromLatin1(utsName.release);
+    info->machine = QString::fromLatin1(utsName.machine);
+    return true;
+}
+
+qlonglong Backend::totalRam() const
+{
+    qlonglong ret = -1;
+#ifdef Q_OS_LINUX
+    struct sysinfo info;
+    if (sysinfo(&info) == 0)
+        // manpage "sizes are given as multiples of mem_unit bytes"
+        ret = qlonglong(info.totalram) * info.mem_unit;
+#endif
+    // TODO other OS', see kinfocenter
+    return ret;
+}
+
+bool Backend::primaryScreen(ScreenInfo *screen) const
+{
+    if (!isGuiApplication()) {
+        return drmScreen(screen);
+    }
+
+    const QScreen *qscreen = QGuiApplication::primaryScreen();
+    if (!qscreen) {
+        return false;
+    }
+    screen->resolution = qscreen->size();
+    screen->physicalSize = qscreen->physicalSize();
+    screen->dpi = qscreen->logicalDotsPerInch();
+    screen->physicalDpi = false;
+    return true;
+}
+
+CpuFeatures Backend::cpuFeatures() const
+{
+    return detectCpuFeatures();
+}
+
+QString Backend::platformName() const
+{
+    if (!isGuiApplication()) { // headless, no platform plugin loaded
+        return QString();
+    }
+
+    return QGuiApplication::platformName();
+}
+
+QLocale Backend::locale() const
+{
+    return QLocale();
+}
+
+bool Backend::isRtl() const
+{
+    if (!isGuiApplication()) { // headless, go by the locale
+        return QLocale().textDirection() == Qt::RightToLeft;
+    }
+
+    return QGuiApplication::isRightToLeft();
+}
+
+Backend *Backend::instance()
+{
+    if (!s_backend) {
+        s_backend = new Backend;
+    }
+    return s_backend;
+}
+
+void Backend::setInstance(Backend *backend)
+{
+    delete s_backend;
+    s_backend = backend;
+}
+
+FixtureBackend::FixtureBackend(const QString &path)
+    : m_path(path), m_valid(false)
+{
+    QFile file(path + QStringLiteral("/fixture.json"));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot read the fixture" << file.fileName() << ":" << file.errorString();
+        return;
+    }
+
+    QJsonParseError error;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+    if (!doc.isObject()) {
+        qWarning() << "Invalid fixture" << file.fileName() << ":" << error.errorString();
+        return;
+    }
+
+    m_fixture = doc.object();
+    m_valid = true;
+}
+
+bool FixtureBackend::isValid() const
+{
+    return m_valid;
+}
+
+QString FixtureBackend::rootPath() const
+{
+    return m_path;
+}
+
+// The entries of the array @p key, each repeated its "count" times
+static QList<QJsonObject> expand(const QJsonObject &fixture, const char *key)
+{
+    QList<QJsonObject> entries;
+    foreach (const QJsonValue &value, fixture.value(key).toArray()) {
+        const QJsonObject entry = value.toObject();
+        for (int i = entry.value("count").toInt(1); i > 0; --i) {
+            entries.append(entry);
+        }
+    }
+    return entries;
+}
+
+QList<ProcessorInfo> FixtureBackend::processors() const
+{
+    QList<ProcessorInfo> processors;
+    foreach (const QJsonObject &entry, expand(m_fixture, "processors")) {
+        ProcessorInfo info;
+        info.vendor = entry.value("vendor").toString();
+        info.product = entry.value("product").toString();
+        info.maxSpeed = entry.value("maxSpeed").toInt();
+        processors.append(info);
+    }
+    return processors;
+}
+
+int FixtureBackend::onlineCpus() const
+{
+    return qMax(1, m_fixture.value("onlineCpus").toInt(expand(m_fixture, "processors").size()));
+}
+
+QList<DriveInfo> FixtureBackend::drives() const
+{
+    QList<DriveInfo> drives;
+    foreach (const QJsonObject &entry, expand(m_fixture, "drives")) {
+        DriveInfo info;
+        info.rotationRate = entry.value("rotationRate").toInt(-1);
+        drives.append(info);
+    }
+    return drives;
+}
+
+QString FixtureBackend::chassis(int timeout, Deadline::Reason *failure) const
+{
+    Q_UNUSED(timeout)
+    const QString chassis = m_fixture.value("chassis").toString();
+    if (chassis.isEmpty() && failure) {
+        *failure = Deadline::Unavailable;
+    }
+    return chassis;
+}
+
+bool FixtureBackend::kernel(KernelInfo *info) const
+{
+    if (!m_fixture.contains("kernel")) {
+        return false;
+    }
+
+    const QJsonObject kernel = m_fixture.value("kernel").toObject();
+    info->name = kernel.value("name").toString();
+    info->release = kernel.value("release").toString();
+    info->machine = kernel.value("machine").toString();
+    return true;
+}
+
+qlonglong FixtureBackend::totalRam() const
+{
+    return qlonglong(m_fixture.value("totalRam").toDouble(-1));
+}
+
+bool FixtureBackend::primaryScreen(ScreenInfo *screen) const
+{
+    if (!m_fixture.contains("screen")) {
+        return drmScreen(screen);
+    }
+
+    const QJsonObject obj = m_fixture.value("screen").toObject();
+    screen->resolution = QSize(obj.value("width").toInt(), obj.value("height").toInt());
+    screen->physicalSize = QSizeF(obj.value("physicalWidth").toDouble(), obj.value("physicalHeight").toDouble());
+    screen->dpi = obj.value("dpi").toDouble();
+    screen->physicalDpi = false;
+    return true;
+}
+
+CpuFeatures FixtureBackend::cpuFeatures() const
+{
+    const QJsonObject obj = m_fixture.value("cpuFeatures").toObject();
+    CpuFeatures features;
+    foreach (const QJsonValue &extension, obj.value("extensions").toArray()) {
+        features.extensions.append(extension.toString());
+    }
+    features.level = obj.value("level").toString();
+    if (!obj.contains("level") && m_fixture.value("kernel").toObject().value("machine").toString() == QLatin1String("x86_64")) {
+        features.level = x86Level(features.extensions);
+    }
+    return features;
+}
+
+QString FixtureBackend::platformName() const
+{
+    return m_fixture.value("platformName").toString();
+}
+
+QLocale FixtureBackend::locale() const
+{
+    return m_fixture.contains("locale") ? QLocale(m_fixture.value("locale").toString()) : QLocale::c();
+}
+
+bool FixtureBackend::isRtl() const
+{
+    return m_fixture.value("rtl").toBool();
+}
@@ -0,0 +1,221 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QLocale>
+#include <QSize>
+#include <QSizeF>
+#include <QString>
+
+#include "cpufeatures.h"
+#include "deadline.h"
+
+namespace KAnalytics {
+
+/**
+ * A CPU as the collectors see it
+ */
+struct ProcessorInfo {
+    QString vendor;
+    QString product;
+    int maxSpeed; ///< in MHz
+};
+
+/**
+ * A hard disk as the collectors see it, optical drives and such are left out
+ */
+struct DriveInfo {
+    int rotationRate; ///< 0 for non-rotational media, -1 if rotational but unknown, the RPM otherwise
+};
+
+/**
+ * The primary screen
+ */
+struct ScreenInfo {
+    QSize resolution;
+    QSizeF physicalSize; ///< in millimeters
+    qreal dpi;           ///< logical, or physical without a platform plugin
+    bool physicalDpi;    ///< whether dpi is the physical one, computed from the EDID size
+};
+
+/**
+ * The running kernel, as reported by uname()
+ */
+struct KernelInfo {
+    QString name;    ///< e.g. "Linux"
+    QString release; ///< e.g. "3.17.2"
+    QString machine; ///< e.g. "x86_64"
+};
+
+/**
+ * Where the collectors get their data from
+ *
+ * Everything Hardware, System and KDE know about the machine comes either from
+ * one of these calls or from the /proc, /sys and /etc trees below rootPath().
+ * The default backend asks the running system; a FixtureBackend replays a
+ * recorded or synthetic machine, which makes collection reproducible and lets
+ * it be measured with device counts the test machine doesn't have.
+ */
+class Q_DECL_EXPORT Backend
+{
+public:
+    virtual ~Backend();
+
+    /**
+     * @return the prefix of the /proc, /sys and /etc paths the collectors read;
+     * empty for the running system
+     */
+    virtual QString rootPath() const;
+
+    /**
+     * @return the CPUs present in the system
+     */
+    virtual QList<ProcessorInfo> processors() const;
+
+    /**
+     * @return the number of online logical CPUs, at least 1
+     */
+    virtual int onlineCpus() const;
+
+    /**
+     * @return the hard disks present in the system
+     */
+    virtual QList<DriveInfo> drives() const;
+
+    /**
+     * @return the chassis or form factor (e.g. "laptop"), an empty string with the
+     * reason in @p failure (if given) if it isn't known within @p timeout msecs
+     */
+    virtual QString chassis(int timeout, Deadline::Reason *failure) const;
+
+    /**
+     * @return false if the kernel couldn't be identified
+     */
+    virtual bool kernel(KernelInfo *info) const;
+
+    /**
+     * @return total RAM present in the system, in bytes; -1 if unknown
+     */
+    virtual qlonglong totalRam() const;
+
+    /**
+     * @return false if there is no screen at all
+     */
+    virtual bool primaryScreen(ScreenInfo *screen) const;
+
+    /**
+     * @return the features of the CPU, usable by the OS
+     */
+    virtual CpuFeatures cpuFeatures() const;
+
+    /**
+     * @return the name of the Qt platform plugin, empty when headless
+     */
+    virtual QString platformName() const;
+
+    /**
+     * @return the user's locale
+     */
+    virtual QLocale locale() const;
+
+    /**
+     * @return whether the UI is laid out right-to-left
+     */
+    virtual bool isRtl() const;
+
+    /**
+     * @return the backend the collectors use, the running system unless
+     * setInstance() was called
+     */
+    static Backend *instance();
+
+    /**
+     * Make the collectors use @p backend, taking ownership of it; 0 goes back
+     * to the running system. Meant to be called once at startup, before
+     * anything is collected.
+     */
+    static void setInstance(Backend *backend);
+};
+
+/**
+ * A machine replayed from a directory
+ *
+ * The directory holds the proc, sys and etc trees the collectors read files
+ * from, copied from a real machine or generated, plus a fixture.json with the
+ * values that don't come from files, e.g.
+ *
+ * @code
+ * {
+ *   "processors": [ { "vendor": "GenuineIntel", "product": "Xeon", "maxSpeed": 2600, "count": 256 } ],
+ *   "onlineCpus": 256,
+ *   "drives": [ { "rotationRate": 0, "count": 500 } ],
+ *   "chassis": "server",
+ *   "kernel": { "name": "Linux", "release": "3.17.2", "machine": "x86_64" },
+ *   "totalRam": 1099511627776,
+ *   "screen": { "width": 1920, "height": 1080, "physicalWidth": 520, "physicalHeight": 290, "dpi": 96 },
+ *   "cpuFeatures": { "extensions": [ "sse4.2", "avx2" ], "level": "x86-64-v3" },
+ *   "platformName": "xcb",
+ *   "locale": "cs_CZ",
+ *   "rtl": false
+ * }
+ * @endcode
+ *
+ * Any processor or drive entry may repeat itself "count" times. Missing values
+ * are reported as unknown, without a "screen" object the DRM/EDID data in the
+ * sys tree is used and without "onlineCpus" all the processors are online. An
+ * x86_64 machine's CPU level is derived from its extensions unless given.
+ */
+class Q_DECL_EXPORT FixtureBackend : public Backend
+{
+public:
+    explicit FixtureBackend(const QString &path);
+
+    /**
+     * @return false if the directory has no readable fixture.json
+     */
+    bool isValid() const;
+
+    QString rootPath() const Q_DECL_OVERRIDE;
+    QList<ProcessorInfo> processors() const Q_DECL_OVERRIDE;
+    int onlineCpus() const Q_DECL_OVERRIDE;
+    QList<DriveInfo> drives() const Q_DECL_OVERRIDE;
+    QString chassis(int timeout, Deadline::Reason *failure) const Q_DECL_OVERRIDE;
+    bool kernel(KernelInfo *info) const Q_DECL_OVERRIDE;
+    qlonglong totalRam() const Q_DECL_OVERRIDE;
+    bool primaryScreen(ScreenInfo *screen) const Q_DECL_OVERRIDE;
+    CpuFeatures cpuFeatures() const Q_DECL_OVERRIDE;
+    QString platformName() const Q_DECL_OVERRIDE;
+    QLocale locale() const Q_DECL_OVERRIDE;
+    bool isRtl() const Q_DECL_OVERRIDE;
+
+private:
+    QString m_path;
+    QJsonObject m_fixture;
+    bool m_valid;
+};
+
+}
+
+#endif // BACKEND_H
@@ -0,0 +1,219 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QtGlobal>
+
+#if defined(Q_PROCESSOR_X86)
+#include <cpuid.h>
+#elif defined(Q_PROCESSOR_ARM) && defined(Q_OS_LINUX)
+#include <sys/auxv.h>
+#endif
+
+#include "cpufeatures.h"
+
+using namespace KAnalytics;
+
+// the extensions each x86-64 psABI microarchitecture level adds to the previous one
+static const char *const levelV2[] = { "cx16", "lahf", "popcnt", "sse3", "sse4.1", "sse4.2", "ssse3" };
+static const char *const levelV3[] = { "avx", "avx2", "bmi1", "bmi2", "f16c", "fma", "lzcnt", "movbe" };
+static const char *const levelV4[] = { "avx512f", "avx512bw", "avx512cd", "avx512dq", "avx512vl" };
+
+template <int N>
+static bool hasAll(const QStringList &extensions, const char *const (&names)[N])
+{
+    for (int i = 0; i < N; ++i) {
+        if (!extensions.contains(QLatin1String(names[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QString KAnalytics::x86Level(const QStringList &extensions)
+{
+    if (!hasAll(extensions, levelV2)) {
+        return QStringLiteral("x86-64");
+    }
+    if (!hasAll(extensions, levelV3)) {
+        return QStringLiteral("x86-64-v2");
+    }
+    if (!hasAll(extensions, levelV4)) {
+        return QStringLiteral("x86-64-v3");
+    }
+    return QStringLiteral("x86-64-v4");
+}
+
+#if defined(Q_PROCESSOR_X86)
+
+// register state the OS must save on context switches for an extension to be usable
+enum OsState {
+    NoState,
+    AvxState,   // YMM
+    Avx512State // opmask and ZMM
+};
+
+struct CpuidBit {
+    unsigned leaf;
+    unsigned subleaf;
+    int reg; // 0 = eax, 1 = ebx, 2 = ecx, 3 = edx
+    unsigned bit;
+    const char *name;
+    OsState state;
+};
+
+// the extensions the x86-64 psABI microarchitecture levels are made of, plus a few AVX-512 extras
+static const CpuidBit cpuidBits[] = {
+    { 0x00000001, 0, 3, 25, "sse", NoState },
+    { 0x00000001, 0, 3, 26, "sse2", NoState },
+    { 0x00000001, 0, 2, 0, "sse3", NoState },
+    { 0x00000001, 0, 2, 9, "ssse3", NoState },
+    { 0x00000001, 0, 2, 19, "sse4.1", NoState },
+    { 0x00000001, 0, 2, 20, "sse4.2", NoState },
+    { 0x00000001, 0, 2, 13, "cx16", NoState },
+    { 0x00000001, 0, 2, 23, "popcnt", NoState },
+    { 0x00000001, 0, 2, 22, "movbe", NoState },
+    { 0x00000001, 0, 2, 12, "fma", AvxState },
+    { 0x00000001, 0, 2, 29, "f16c", AvxState },
+    { 0x00000001, 0, 2, 28, "avx", AvxState },
+    { 0x00000007, 0, 1, 5, "avx2", AvxState },
+    { 0x00000007, 0, 1, 3, "bmi1", NoState },
+    { 0x00000007, 0, 1, 8, "bmi2", NoState },
+    { 0x00000007, 0, 1, 16, "avx512f", Avx512State },
+    { 0x00000007, 0, 1, 17, "avx512dq", Avx512State },
+    { 0x00000007, 0, 1, 28, "avx512cd", Avx512State },
+    { 0x00000007, 0, 1, 30, "avx512bw", Avx512State },
+    { 0x00000007, 0, 1, 31, "avx512vl", Avx512State },
+    { 0x00000007, 0, 2, 1, "avx512vbmi", Avx512State },
+    { 0x00000007, 0, 2, 11, "avx512vnni", Avx512State },
+    { 0x80000001, 0, 2, 0, "lahf", NoState },
+    { 0x80000001, 0, 2, 5, "lzcnt", NoState }
+};
+
+static bool cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4])
+{
+    if (__get_cpuid_max(leaf & 0x80000000, 0) < leaf) {
+        return false;
+    }
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+    return true;
+}
+
+CpuFeatures KAnalytics::detectCpuFeatures()
+{
+    CpuFeatures features;
+
+    unsigned regs[4];
+    if (!cpuid(1, 0, regs)) {
+        return features;
+    }
+
+    // without the OS saving their state AVX and AVX-512 instructions fault, no matter what the CPU supports
+    unsigned xcr0 = 0;
+    if (regs[2] & (1u << 27)) { // OSXSAVE
+        unsigned edx;
+        __asm__ volatile("xgetbv" : "=a"(xcr0), "=d"(edx) : "c"(0));
+    }
+    const bool osAvx = (xcr0 & 0x06) == 0x06;
+    const bool osAvx512 = osAvx && (xcr0 & 0xe0) == 0xe0;
+
+    unsigned cachedLeaf = 1;
+    for (unsigned i = 0; i < sizeof(cpuidBits) / sizeof(cpuidBits[0]); ++i) {
+        const CpuidBit &bit = cpuidBits[i];
+        if (bit.leaf != cachedLeaf) {
+            if (!cpuid(bit.leaf, bit.subleaf, regs)) {
+                regs[0] = regs[1] = regs[2] = regs[3] = 0;
+            }
+            cachedLeaf = bit.leaf;
+        }
+        if (!(regs[bit.reg] & (1u << bit.bit))) {
+            continue;
+        }
+
+        if ((bit.state == AvxState && !osAvx) || (bit.state == Avx512State && !osAvx512)) {
+            continue;
+        }
+        features.extensions.append(QLatin1String(bit.name));
+    }
+
+    // levels only exist for 64-bit capable CPUs (long mode)
+    if (cpuid(0x80000001, 0, regs) && (regs[3] & (1u << 29))) {
+        features.level = x86Level(features.extensions);
+    }
+
+    return features;
+}
+
+#elif defined(Q_PROCESSOR_ARM) && defined(Q_OS_LINUX)
+
+CpuFeatures KAnalytics::detectCpuFeatures()
+{
+    CpuFeatures features;
+
+    const unsigned long hwcap = getauxval(AT_HWCAP);
+#if defined(Q_PROCESSOR_ARM_64)
+    const unsigned long hwcap2 = getauxval(AT_HWCAP2);
+    // bits from the kernel's arch/arm64/include/uapi/asm/hwcap.h
+    if (hwcap & (1ul << 1)) {
+        features.extensions << QStringLiteral("neon");
+        features.level = QStringLiteral("neon");
+    }
+    if (hwcap & (1ul << 3)) {
+        features.extensions << QStringLiteral("aes");
+    }
+    if (hwcap & (1ul << 7)) {
+        features.extensions << QStringLiteral("crc32");
+    }
+    if (hwcap & (1ul << 8)) {
+        features.extensions << QStringLiteral("atomics");
+    }
+    if (hwcap & (1ul << 20)) {
+        features.extensions << QStringLiteral("dotprod");
+    }
+    if (hwcap & (1ul << 22)) {
+        features.extensions << QStringLiteral("sve");
+        features.level = QStringLiteral("sve");
+    }
+    if (hwcap2 & (1ul << 1)) {
+        features.extensions << QStringLiteral("sve2");
+        features.level = QStringLiteral("sve2");
+    }
+#else
+    // arch/arm/include/uapi/asm/hwcap.h
+    if (hwcap & (1ul << 12)) {
+        features.extensions << QStringLiteral("neon");
+        features.level = QStringLiteral("neon");
+    }
+#endif
+
+    return features;
+}
+
+#else
+
+// No detection elsewhere (e.g. PowerPC, RISC-V or ARM outside Linux): there is no
+// portable way to ask, and guessing from the compiler's target would describe the
+// binary rather than the CPU, so nothing is reported
+CpuFeatures KAnalytics::detectCpuFeatures()
+{
+    return CpuFeatures();
+}
+
+#endif
@@ -0,0 +1,53 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+#include <QString>
+#include <QStringList>
+
+namespace KAnalytics {
+
+/**
+ * SIMD and ISA extensions of the CPU this runs on, as opposed to the ones the
+ * binary was built for; detected with cpuid on x86 and the ELF auxiliary vector
+ * (AT_HWCAP) on ARM Linux; other platforms report no extensions and an empty level
+ */
+struct CpuFeatures {
+    QStringList extensions; ///< e.g. "sse4.2", "avx2", "avx512f", "neon", "sve"
+    QString level;          ///< e.g. "x86-64-v3" or "sve2", empty if unknown
+};
+
+/**
+ * @return the features of the CPU, usable by the OS (e.g. AVX with XSAVE enabled)
+ */
+CpuFeatures detectCpuFeatures();
+
+/**
+ * @return the x86-64 microarchitecture level ("x86-64" up to "x86-64-v4") of a
+ * 64-bit CPU with the given @p extensions
+ */
+Q_DECL_EXPORT QString x86Level(const QStringList &extensions);
+
+}
+
+#endif // CPUFEATURES_H
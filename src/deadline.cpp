@@ -0,0 +1,78 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "deadline.h"
+
+using namespace KAnalytics;
+
+Deadline::Deadline(qint64 msecs)
+    : m_msecs(msecs)
+{
+    m_timer.start();
+}
+
+Deadline::Deadline(const Deadline &parent, qint64 msecs)
+    : m_msecs(msecs)
+{
+    m_timer.start();
+    const qint64 parentRemaining = parent.remainingTime();
+    if (parentRemaining >= 0 && (m_msecs < 0 || parentRemaining < m_msecs)) {
+        m_msecs = parentRemaining;
+    }
+}
+
+bool Deadline::hasExpired() const
+{
+    return m_msecs >= 0 && m_timer.hasExpired(m_msecs);
+}
+
+qint64 Deadline::remainingTime() const
+{
+    if (m_msecs < 0) {
+        return -1;
+    }
+
+    return qMax<qint64>(0, m_msecs - m_timer.elapsed());
+}
+
+int Deadline::timeout(int budget) const
+{
+    const qint64 remaining = remainingTime();
+    if (remaining < 0) {
+        return budget;
+    }
+
+    return static_cast<int>(qMin<qint64>(budget, remaining));
+}
+
+QString Deadline::reasonString(Reason reason)
+{
+    switch (reason) {
+    case Expired:
+        return QStringLiteral("deadline");
+    case TimedOut:
+        return QStringLiteral("timeout");
+    case Unavailable:
+        return QStringLiteral("unavailable");
+    }
+
+    return QString();
+}
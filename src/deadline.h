@@ -0,0 +1,86 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <QElapsedTimer>
+#include <QString>
+
+namespace KAnalytics {
+
+/**
+ * Collection deadline
+ *
+ * Bounds the time a collection may take. Collectors check it before running a probe
+ * and pass the remaining time on to probes that can time out (e.g. D-Bus calls);
+ * probes that don't make it are reported as missing together with a Reason.
+ */
+class Q_DECL_EXPORT Deadline
+{
+public:
+    /**
+     * Why a probe's value is missing from the report
+     */
+    enum Reason {
+        Expired,     ///< the probe was skipped, the deadline had already passed
+        TimedOut,    ///< the probe ran but didn't answer within its budget
+        Unavailable  ///< the probe answered but has no data (e.g. no screen)
+    };
+
+    /**
+     * Create a deadline @p msecs milliseconds from now, a negative value never expires
+     */
+    explicit Deadline(qint64 msecs = -1);
+
+    /**
+     * Create a deadline @p msecs milliseconds from now, but no later than @p parent
+     */
+    Deadline(const Deadline &parent, qint64 msecs);
+
+    /**
+     * @return whether the deadline has passed
+     */
+    bool hasExpired() const;
+
+    /**
+     * @return the remaining time in milliseconds, -1 if the deadline never expires
+     */
+    qint64 remainingTime() const;
+
+    /**
+     * @return the timeout a probe with the given @p budget (in milliseconds) may use,
+     * i.e. the budget cut down to the remaining time
+     */
+    int timeout(int budget) const;
+
+    /**
+     * @return the reason code as written to the "missing" object of a report
+     */
+    static QString reasonString(Reason reason);
+
+private:
+    QElapsedTimer m_timer;
+    qint64 m_msecs;
+};
+
+}
+
+#endif // DEADLINE_H
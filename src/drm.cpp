@@ -0,0 +1,177 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "drm.h"
+#include "sysfs.h"
+
+using namespace KAnalytics;
+
+
+struct PciVendor {
+    quint16 id;
+    const char *name;
+};
+
+// GPU vendors only, sorted by ID for the binary search in vendorName()
+static const PciVendor pciVendors[] = {
+    { 0x1002, "AMD" },
+    { 0x102b, "Matrox" },
+    { 0x10de, "NVIDIA" },
+    { 0x1234, "QEMU" },
+    { 0x13b5, "ARM" },
+    { 0x15ad, "VMware" },
+    { 0x1a03, "ASPEED" },
+    { 0x1af4, "Red Hat (virtio)" },
+    { 0x1b36, "Red Hat (QXL)" },
+    { 0x5143, "Qualcomm" },
+    { 0x80ee, "VirtualBox" },
+    { 0x8086, "Intel" }
+};
+
+static bool operator<(const PciVendor &vendor, quint16 id)
+{
+    return vendor.id < id;
+}
+
+static QString vendorName(quint16 id)
+{
+    const PciVendor *end = pciVendors + sizeof(pciVendors) / sizeof(pciVendors[0]);
+    const PciVendor *it = std::lower_bound(pciVendors, end, id);
+    if (it != end && it->id == id) {
+        return QLatin1String(it->name);
+    }
+
+    return QString();
+}
+
+// modes look like "1920x1080" or "1920x1080i"
+static QSize parseMode(const QByteArray &mode)
+{
+    const int x = mode.indexOf('x');
+    if (x <= 0) {
+        return QSize();
+    }
+
+    int height = 0;
+    for (int i = x + 1; i < mode.size() && mode.at(i) >= '0' && mode.at(i) <= '9'; ++i) {
+        height = height * 10 + (mode.at(i) - '0');
+    }
+    return QSize(mode.left(x).toInt(), height);
+}
+
+static QSizeF parseEdidSize(const QByteArray &edid)
+{
+    if (edid.size() < 128 || !edid.startsWith(QByteArray::fromHex("00ffffffffffff00"))) {
+        return QSizeF();
+    }
+
+    const uchar *data = reinterpret_cast<const uchar *>(edid.constData());
+
+    // the first detailed timing descriptor has the image size in mm...
+    const bool isTiming = data[54] || data[55]; // a zero pixel clock marks a display descriptor instead
+    const int width = data[66] | ((data[68] & 0xf0) << 4);
+    const int height = data[67] | ((data[68] & 0x0f) << 8);
+    if (isTiming && width > 0 && height > 0) {
+        return QSizeF(width, height);
+    }
+
+    // ...the basic display parameters only in cm
+    if (data[21] && data[22]) {
+        return QSizeF(data[21] * 10, data[22] * 10);
+    }
+
+    return QSizeF();
+}
+
+QList<DrmGpu> KAnalytics::drmGpus()
+{
+    QList<DrmGpu> gpus;
+
+    const QDir dir(sysPath("/sys/class/drm"));
+    const QStringList cards = dir.entryList(QStringList() << QStringLiteral("card*"), QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    foreach (const QString &card, cards) {
+        if (card.contains(QLatin1Char('-'))) { // a connector, not a card
+            continue;
+        }
+
+        const QString devicePath = dir.filePath(card) + QStringLiteral("/device");
+
+        DrmGpu gpu;
+        gpu.card = card;
+        gpu.vendorId = readSysFile(devicePath + QStringLiteral("/vendor")).toUShort(0, 16); // "0x8086"
+        gpu.deviceId = readSysFile(devicePath + QStringLiteral("/device")).toUShort(0, 16);
+        gpu.vendor = vendorName(gpu.vendorId);
+        gpu.driver = QFileInfo(QFileInfo(devicePath + QStringLiteral("/driver")).symLinkTarget()).fileName();
+
+        // only amdgpu tells the VRAM size directly. The BARs don't: without Resizable BAR
+        // NVIDIA's is 256 MiB whatever the VRAM, and integrated GPUs have none of their own
+        const QByteArray vramTotal = readSysFile(devicePath + QStringLiteral("/mem_info_vram_total"));
+        gpu.vram = vramTotal.isEmpty() ? -1 : vramTotal.toLongLong();
+
+        gpus.append(gpu);
+    }
+
+    return gpus;
+}
+
+// "card0-eDP-1", the connector type is between the card and the index
+static bool isInternalConnector(const QString &connector)
+{
+    const QString type = connector.mid(connector.indexOf(QLatin1Char('-')) + 1).section(QLatin1Char('-'), 0, -2);
+    return type == QLatin1String("eDP") || type == QLatin1String("LVDS") || type == QLatin1String("DSI");
+}
+
+QList<DrmDisplay> KAnalytics::drmDisplays()
+{
+    QList<DrmDisplay> displays;
+
+    const QDir dir(sysPath("/sys/class/drm"));
+    const QStringList connectors = dir.entryList(QStringList() << QStringLiteral("card*-*"), QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    foreach (const QString &connector, connectors) {
+        const QString path = dir.filePath(connector);
+        if (readSysFile(path + QStringLiteral("/status")) != "connected") {
+            continue;
+        }
+
+        DrmDisplay display;
+        display.connector = connector;
+        display.internal = isInternalConnector(connector);
+
+        const QByteArray modes = readSysFile(path + QStringLiteral("/modes"));
+        display.resolution = parseMode(modes.left(modes.indexOf('\n'))); // the preferred mode comes first
+
+        QFile edid(path + QStringLiteral("/edid"));
+        if (edid.open(QIODevice::ReadOnly)) {
+            display.physicalSize = parseEdidSize(edid.read(128)); // the base block is all we need
+        }
+
+        displays.append(display);
+    }
+
+    std::stable_partition(displays.begin(), displays.end(), [](const DrmDisplay &display) { return display.internal; });
+    return displays;
+}
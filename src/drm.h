@@ -0,0 +1,69 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef DRM_H
+#define DRM_H
+
+#include <QList>
+#include <QSize>
+#include <QSizeF>
+#include <QString>
+
+namespace KAnalytics {
+
+/**
+ * A display connected to a DRM connector, as described by sysfs
+ */
+struct DrmDisplay {
+    QString connector;   ///< e.g. "card0-eDP-1"
+    QSize resolution;    ///< the preferred mode
+    QSizeF physicalSize; ///< in millimeters, from the EDID
+    bool internal;       ///< a built-in panel (eDP, LVDS or DSI connector)
+};
+
+/**
+ * A graphics card as exposed by the kernel's DRM subsystem
+ */
+struct DrmGpu {
+    QString card;      ///< e.g. "card0"
+    quint16 vendorId;  ///< PCI vendor ID, 0 for non-PCI (SoC) devices
+    quint16 deviceId;  ///< PCI device ID, 0 for non-PCI (SoC) devices
+    QString vendor;    ///< vendor name from a built-in table, empty if unknown
+    QString driver;    ///< kernel driver, e.g. "i915" or "amdgpu"
+    qint64 vram;       ///< dedicated video memory in bytes, -1 if unknown or none
+};
+
+/**
+ * @return the displays connected to any DRM card, read from /sys/class/drm;
+ * works without a display server connection. Built-in panels come first, as
+ * the primary display of a laptop, then the others by connector name.
+ */
+Q_DECL_EXPORT QList<DrmDisplay> drmDisplays();
+
+/**
+ * @return the graphics cards, read from /sys/class/drm without
+ * creating a GL context or connecting to a display server
+ */
+Q_DECL_EXPORT QList<DrmGpu> drmGpus();
+
+}
+
+#endif // DRM_H
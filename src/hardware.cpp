@@ -19,54 +19,85 @@
 */
 
 #include <QString>
-#include <QDBusConnectionInterface>
-#include <QDBusInterface>
 #include <QDebug>
 #include <QJsonDocument>
-#include <QGuiApplication>
-#include <QScreen>
-
-#include <Solid/Processor>
-#include <Solid/StorageDrive>
-#include <Solid/GenericInterface>
-
-#ifdef Q_OS_LINUX
-#include <sys/sysinfo.h>
-#endif
-#include <sys/utsname.h>
+#include <QJsonArray>
 
 #include "hardware.h"
+#include "backend.h"
+#include "drm.h"
+#include "trace.h"
 
-const QString hostname1Service = QStringLiteral("org.freedesktop.hostname1");
+static const int CHASSIS_TIMEOUT = 3000; // msec; hostnamed may need to be activated first
 
 using namespace KAnalytics;
 
+static QJsonObject topologyToJson(const Topology &topology)
+{
+    QJsonObject obj;
+    obj.insert("sockets", topology.sockets);
+    obj.insert("cores", topology.cores);
+    obj.insert("threads", topology.threads);
+    obj.insert("smt", topology.smt);
+
+    QJsonObject caches; // "L1d", "L1i", "L2", "L3"
+    foreach (const CpuCache &cache, topology.caches) {
+        QString name = QStringLiteral("L%1").arg(cache.level);
+        if (cache.type == QLatin1String("Data")) {
+            name += QLatin1Char('d');
+        } else if (cache.type == QLatin1String("Instruction")) {
+            name += QLatin1Char('i');
+        }
+        caches.insert(name, cache.size);
+    }
+    obj.insert("caches", caches);
+
+    QJsonArray nodes;
+    foreach (qint64 memory, topology.nodeMemory) {
+        nodes.append(double(memory));
+    }
+    obj.insert("numaNodes", nodes);
+
+    QJsonObject hugepages; // page size in kB -> reserved pages, as in sysfs
+    QMap<qint64, int>::const_iterator it;
+    for (it = topology.hugepages.constBegin(); it != topology.hugepages.constEnd(); ++it) {
+        hugepages.insert(QStringLiteral("%1kB").arg(it.key() / 1024), it.value());
+    }
+    obj.insert("hugepages", hugepages);
+
+    return obj;
+}
+
 Hardware::Hardware()
     : m_hasHdd(false), m_hasSsd(false)
 {
-    m_cpuList = Solid::Device::listFromType(Solid::DeviceInterface::Processor);
+    {
+        TraceSpan span("hardware", "cpus");
+        m_cpuList = Backend::instance()->processors();
+    }
+    {
+        TraceSpan span("hardware", "cpuFeatures");
+        m_cpuFeatures = Backend::instance()->cpuFeatures();
+    }
     analyzeDrives();
 }
 
 QString Hardware::chassis() const
 {
-    if (!QDBusConnection::systemBus().interface()->isServiceRegistered(hostname1Service)) {
-        QDBusConnection::systemBus().interface()->startService(hostname1Service);
-    }
-
-    QDBusInterface iface(hostname1Service, "/org/freedesktop/hostname1", hostname1Service, QDBusConnection::systemBus());
-    if (iface.isValid()) {
-        return iface.property("Chassis").toString();
-    }
+    return queryChassis(CHASSIS_TIMEOUT, 0);
+}
 
-    return QString();
+QString Hardware::queryChassis(int timeout, Deadline::Reason *failure) const
+{
+    TraceSpan span("hardware", "chassis");
+    return Backend::instance()->chassis(timeout, failure);
 }
 
 QString Hardware::machine() const
 {
-    struct utsname utsName;
-    if (uname(&utsName) != -1) {
-        return utsName.machine;
+    KernelInfo kernel;
+    if (Backend::instance()->kernel(&kernel)) {
+        return kernel.machine;
     }
 
     return QString();
@@ -81,7 +112,7 @@ QString Hardware::cpuModel() const
 {
     // we just take the first one, hopefully nobody has different kinds of them :)
     if (!m_cpuList.isEmpty()) {
-        return m_cpuList.first().product();
+        return m_cpuList.first().product;
     }
 
     return QString();
@@ -91,7 +122,7 @@ QString Hardware::cpuVendor() const
 {
     // we just take the first one, hopefully nobody has different kinds of them :)
     if (!m_cpuList.isEmpty()) {
-        return m_cpuList.first().vendor();
+        return m_cpuList.first().vendor;
     }
 
     return QString();
@@ -101,8 +132,7 @@ int Hardware::cpuSpeed() const
 {
     // we just take the first one, hopefully nobody has different kinds of them :)
     if (!m_cpuList.isEmpty()) {
-        const Solid::Processor * proc = m_cpuList.first().as<Solid::Processor>();
-        return proc->maxSpeed();
+        return m_cpuList.first().maxSpeed;
     }
 
     return 0;
@@ -113,32 +143,61 @@ int Hardware::architecture() const
     return QT_POINTER_SIZE == 8 ? 64 : 32;
 }
 
+QStringList Hardware::cpuFeatures() const
+{
+    return m_cpuFeatures.extensions;
+}
+
+QString Hardware::cpuLevel() const
+{
+    return m_cpuFeatures.level;
+}
+
 qlonglong Hardware::totalRam() const
 {
-    qlonglong ret = -1;
-#ifdef Q_OS_LINUX
-    struct sysinfo info;
-    if (sysinfo(&info) == 0)
-        // manpage "sizes are given as multiples of mem_unit bytes"
-        ret = info.totalram * info.mem_unit;
-#endif
-    // TODO other OS', see kinfocenter
-    return ret;
+    return Backend::instance()->totalRam();
+}
+
+Topology Hardware::topology() const
+{
+    TraceSpan span("hardware", "topology");
+    return detectTopology();
 }
 
 QSize Hardware::screenResolution() const
 {
-    return QGuiApplication::primaryScreen()->size();
+    ScreenInfo screen;
+    Backend::instance()->primaryScreen(&screen);
+    return screen.resolution;
 }
 
 QSizeF Hardware::screenSize() const
 {
-    return QGuiApplication::primaryScreen()->physicalSize();
+    ScreenInfo screen;
+    Backend::instance()->primaryScreen(&screen);
+    return screen.physicalSize;
 }
 
 qreal Hardware::screenDpi() const
 {
-    return QGuiApplication::primaryScreen()->logicalDotsPerInch();
+    ScreenInfo screen;
+    screen.dpi = 0;
+    Backend::instance()->primaryScreen(&screen);
+    return screen.dpi;
+}
+
+bool Hardware::isScreenDpiPhysical() const
+{
+    ScreenInfo screen;
+    screen.physicalDpi = false;
+    Backend::instance()->primaryScreen(&screen);
+    return screen.physicalDpi;
+}
+
+QList<DrmGpu> Hardware::gpus() const
+{
+    TraceSpan span("hardware", "gpus");
+    return drmGpus();
 }
 
 bool Hardware::hasHdd() const
@@ -152,43 +211,81 @@ bool Hardware::hasSsd() const
 }
 
 QJsonObject Hardware::toJson() const
+{
+    return toJson(Deadline());
+}
+
+QJsonObject Hardware::toJson(const Deadline &deadline) const
 {
     QJsonObject obj;
-    obj.insert("chassis", chassis());
+    QJsonObject missing;
+
+    // CPUs and drives were already enumerated in the constructor, only the chassis
+    // (an IPC roundtrip) and the screen need to be checked against the deadline
+    if (deadline.hasExpired()) {
+        missing.insert("chassis", Deadline::reasonString(Deadline::Expired));
+    } else {
+        Deadline::Reason failure = Deadline::Unavailable;
+        const QString chassisName = queryChassis(deadline.timeout(CHASSIS_TIMEOUT), &failure);
+        if (!chassisName.isEmpty()) {
+            obj.insert("chassis", chassisName);
+        } else {
+            missing.insert("chassis", Deadline::reasonString(failure));
+        }
+    }
     obj.insert("machine", machine());
     obj.insert("numCpus", numCpus());
     obj.insert("cpuModel", cpuModel());
     obj.insert("cpuVendor", cpuVendor());
     obj.insert("cpuSpeed", cpuSpeed());
     obj.insert("architecture", architecture());
+    obj.insert("cpuFeatures", QJsonArray::fromStringList(cpuFeatures()));
+    obj.insert("cpuLevel", cpuLevel());
     obj.insert("totalRam", totalRam());
+    obj.insert("topology", topologyToJson(topology()));
     obj.insert("hdd", hasHdd());
     obj.insert("ssd", hasSsd());
-    obj.insert("screenDpi", screenDpi());
-    const QSize res = screenResolution();
-    obj.insert("screenResolution", QStringLiteral("%1x%2").arg(res.width()).arg(res.height()));
-    const QSizeF size = screenSize();
-    obj.insert("screenSize", QStringLiteral("%1x%2").arg(size.width()).arg(size.height()));
+
+    QJsonArray gpuArray;
+    foreach (const DrmGpu &gpu, gpus()) {
+        QJsonObject gpuObj;
+        gpuObj.insert("vendor", gpu.vendor);
+        gpuObj.insert("vendorId", QStringLiteral("%1").arg(gpu.vendorId, 4, 16, QLatin1Char('0')));
+        gpuObj.insert("deviceId", QStringLiteral("%1").arg(gpu.deviceId, 4, 16, QLatin1Char('0')));
+        gpuObj.insert("driver", gpu.driver);
+        gpuObj.insert("vram", gpu.vram);
+        gpuArray.append(gpuObj);
+    }
+    obj.insert("gpus", gpuArray);
+
+    if (deadline.hasExpired()) {
+        missing.insert("screen", Deadline::reasonString(Deadline::Expired));
+    } else {
+        TraceSpan span("hardware", "screen");
+        ScreenInfo screen;
+        if (Backend::instance()->primaryScreen(&screen)) {
+            obj.insert("screenDpi", screen.dpi);
+            obj.insert("screenResolution", QStringLiteral("%1x%2").arg(screen.resolution.width()).arg(screen.resolution.height()));
+            obj.insert("screenSize", QStringLiteral("%1x%2").arg(screen.physicalSize.width()).arg(screen.physicalSize.height()));
+        } else {
+            missing.insert("screen", Deadline::reasonString(Deadline::Unavailable));
+        }
+    }
+
+    if (!missing.isEmpty()) {
+        obj.insert("missing", missing);
+    }
     return obj;
 }
 
 void Hardware::analyzeDrives()
 {
-    const QList<Solid::Device> driveList = Solid::Device::listFromType(Solid::DeviceInterface::StorageDrive);
-    foreach (Solid::Device device, driveList) {
-        Solid::StorageDrive * drive = device.as<Solid::StorageDrive>();
-        if (drive) {
-            if (drive->driveType() != Solid::StorageDrive::HardDisk) { // not interested in optical drives and such
-                continue;
-            }
-            Solid::GenericInterface * genIface = device.as<Solid::GenericInterface>();
-            const int rotationRate = genIface->property("RotationRate").toInt();
-            //qDebug() << "Drive " << device.udi() << " rate: " << rotationRate;
-            if (rotationRate == 0) { // 0 means no rotational media, -1 rotational but unknown, everything else reports the rate
-                m_hasSsd = true;
-            } else {
-                m_hasHdd = true;
-            }
+    TraceSpan span("hardware", "analyzeDrives");
+    foreach (const DriveInfo &drive, Backend::instance()->drives()) {
+        if (drive.rotationRate == 0) { // 0 means no rotational media, -1 rotational but unknown, everything else reports the rate
+            m_hasSsd = true;
+        } else {
+            m_hasHdd = true;
         }
     }
 }
@@ -25,7 +25,11 @@
 #include <QtGlobal>
 #include <QJsonObject>
 
-#include <Solid/Device>
+#include "backend.h"
+#include "deadline.h"
+#include "drm.h"
+#include "cpufeatures.h"
+#include "topology.h"
 
 class QString;
 
@@ -42,7 +46,8 @@ public:
     Hardware();
 
     /**
-     * @return the chassis or form factor of this computer (e.g. "laptop")
+     * @return the chassis or form factor of this computer (e.g. "laptop"),
+     * an empty string if hostnamed doesn't answer within a few seconds
      */
     QString chassis() const;
 
@@ -76,16 +81,40 @@ public:
      */
     int architecture() const;
 
+    /**
+     * @return the SIMD and ISA extensions the CPU supports (e.g. "avx2", "sve")
+     */
+    QStringList cpuFeatures() const;
+
+    /**
+     * @return the CPU's microarchitecture level (e.g. "x86-64-v3"),
+     * or its highest SIMD extension on ARM (e.g. "sve2"); empty if unknown
+     */
+    QString cpuLevel() const;
+
     /**
      * @return total RAM present in the system, in bytes; -1 if unknown
      */
     qlonglong totalRam() const;
 
+    /**
+     * @return the CPU caches, sockets, cores, SMT state, NUMA nodes and huge pages
+     */
+    Topology topology() const;
+
     /**
      * @return the number of logical dots or pixels per inch.
+     *
+     * Without a QGuiApplication the screen is read from DRM/EDID data
+     * in sysfs and the physical DPI is returned instead.
      */
     qreal screenDpi() const;
 
+    /**
+     * @return whether screenDpi() is the physical DPI, from DRM/EDID data
+     */
+    bool isScreenDpiPhysical() const;
+
     /**
      * @return the pixel resolution of the screen
      */
@@ -96,6 +125,11 @@ public:
      */
     QSizeF screenSize() const;
 
+    /**
+     * @return the graphics cards present in the system
+     */
+    QList<DrmGpu> gpus() const;
+
     /**
      * @return whether the system has any HDD (rotational storage)
      */
@@ -111,9 +145,18 @@ public:
      */
     QJsonObject toJson() const;
 
+    /**
+     * @return hardware information analytics data as a QJsonObject, skipping
+     * the probes that can't complete before @p deadline; those are listed
+     * together with the reason in the "missing" object
+     */
+    QJsonObject toJson(const Deadline &deadline) const;
+
 private:
+    QString queryChassis(int timeout, Deadline::Reason *failure) const;
     void analyzeDrives();
-    QList<Solid::Device> m_cpuList;
+    QList<ProcessorInfo> m_cpuList;
+    CpuFeatures m_cpuFeatures;
     bool m_hasHdd;
     bool m_hasSsd;
 };
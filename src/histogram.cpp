@@ -0,0 +1,123 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+
+#include <QJsonArray>
+
+#include "histogram.h"
+
+using namespace KAnalytics;
+
+Histogram::Histogram(const QVector<double> &bounds)
+    : m_bounds(bounds), m_counts(bounds.size() + 1, 0), m_count(0)
+{
+}
+
+void Histogram::add(double value, quint64 count)
+{
+    // first bound >= value, the end is the overflow bucket
+    const int bucket = std::lower_bound(m_bounds.constBegin(), m_bounds.constEnd(), value) - m_bounds.constBegin();
+    m_counts[bucket] += count;
+    m_count += count;
+}
+
+void Histogram::merge(const Histogram &other)
+{
+    if (other.m_bounds != m_bounds) {
+        return;
+    }
+
+    for (int i = 0; i < m_counts.size(); ++i) {
+        m_counts[i] += other.m_counts.at(i);
+    }
+    m_count += other.m_count;
+}
+
+void Histogram::clear()
+{
+    m_counts.fill(0);
+    m_count = 0;
+}
+
+quint64 Histogram::count() const
+{
+    return m_count;
+}
+
+double Histogram::percentile(double p) const
+{
+    if (!m_count || m_bounds.isEmpty()) {
+        return 0;
+    }
+
+    const double rank = qBound(0.0, p, 100.0) / 100 * m_count;
+    quint64 seen = 0;
+    for (int i = 0; i < m_bounds.size(); ++i) {
+        seen += m_counts.at(i);
+        if (seen && seen >= rank) {
+            return m_bounds.at(i);
+        }
+    }
+
+    return m_bounds.last();
+}
+
+QVector<double> Histogram::bounds() const
+{
+    return m_bounds;
+}
+
+QVector<quint64> Histogram::counts() const
+{
+    return m_counts;
+}
+
+void Histogram::setCounts(const QVector<quint64> &counts)
+{
+    if (counts.size() != m_counts.size()) {
+        return;
+    }
+
+    m_counts = counts;
+    m_count = 0;
+    foreach (quint64 count, m_counts) {
+        m_count += count;
+    }
+}
+
+QJsonObject Histogram::toJson() const
+{
+    QJsonArray bounds;
+    foreach (double bound, m_bounds) {
+        bounds.append(bound);
+    }
+
+    QJsonArray counts;
+    foreach (quint64 count, m_counts) {
+        counts.append(double(count));
+    }
+
+    QJsonObject obj;
+    obj.insert("bounds", bounds);
+    obj.insert("counts", counts);
+    return obj;
+}
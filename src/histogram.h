@@ -0,0 +1,99 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <QJsonObject>
+#include <QVector>
+
+namespace KAnalytics {
+
+/**
+ * Fixed-bucket histogram
+ *
+ * Counts values into buckets given by their inclusive upper bounds, plus one
+ * overflow bucket for everything above the last bound. The memory use is fixed
+ * by the bounds, no matter how many values are added.
+ */
+class Q_DECL_EXPORT Histogram
+{
+public:
+    /**
+     * Create an empty histogram with the given ascending bucket @p bounds
+     */
+    explicit Histogram(const QVector<double> &bounds = QVector<double>());
+
+    /**
+     * Count @p value into its bucket
+     */
+    void add(double value, quint64 count = 1);
+
+    /**
+     * Add the counts of @p other, which must have the same bounds
+     */
+    void merge(const Histogram &other);
+
+    /**
+     * Reset all the counts to zero
+     */
+    void clear();
+
+    /**
+     * @return the number of values added
+     */
+    quint64 count() const;
+
+    /**
+     * @return the upper bound of the bucket holding the @p p-th percentile (0-100),
+     * the last bound for the overflow bucket, 0 for an empty histogram
+     */
+    double percentile(double p) const;
+
+    /**
+     * @return the bucket bounds
+     */
+    QVector<double> bounds() const;
+
+    /**
+     * @return the bucket counts, one more than there are bounds
+     */
+    QVector<quint64> counts() const;
+
+    /**
+     * Replace the counts, e.g. with ones persisted earlier; ignored if the size doesn't match
+     */
+    void setCounts(const QVector<quint64> &counts);
+
+    /**
+     * @return the histogram as a QJsonObject with "bounds" and "counts" arrays
+     */
+    QJsonObject toJson() const;
+
+private:
+    QVector<double> m_bounds;
+    QVector<quint64> m_counts;
+    quint64 m_count;
+};
+
+}
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,40 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef HTTP_H
+#define HTTP_H
+
+#include <QByteArray>
+#include <QDateTime>
+
+namespace KAnalytics {
+
+/**
+ * Parse the value of a Retry-After header, either delay-seconds or an
+ * HTTP-date ("Fri, 31 Dec 1999 23:59:59 GMT") relative to @p now.
+ *
+ * @return the delay in seconds, -1 if the value is malformed or the date has passed
+ */
+Q_DECL_EXPORT qint64 parseRetryAfter(const QByteArray &value, const QDateTime &now);
+
+}
+
+#endif // HTTP_H
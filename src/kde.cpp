@@ -21,11 +21,11 @@
 #include <QString>
 #include <QJsonDocument>
 #include <QLocale>
-#include <QGuiApplication>
 
 #include <KF5/plasma/version.h>
 
 #include "kde.h"
+#include "backend.h"
 
 using namespace KAnalytics;
 
@@ -45,22 +45,22 @@ QString KDE::plasmaVersion() const
 
 QString KDE::userLocale() const
 {
-    return QLocale().name();
+    return Backend::instance()->locale().name();
 }
 
 QLocale::Language KDE::userLanguage() const
 {
-    return QLocale().language();
+    return Backend::instance()->locale().language();
 }
 
 QLocale::Country KDE::userCountry() const
 {
-    return QLocale().country();
+    return Backend::instance()->locale().country();
 }
 
 bool KDE::isRtl() const
 {
-    return QGuiApplication::isRightToLeft();
+    return Backend::instance()->isRtl();
 }
 
 QJsonObject KDE::toJson() const
@@ -64,7 +64,8 @@ public:
     QLocale::Country userCountry() const;
 
     /**
-     * @return @p true if the application's layout direction is right-to-left
+     * @return @p true if the application's layout direction is right-to-left,
+     * or without a QGuiApplication, if the locale's text direction is
      */
     bool isRtl() const;
 
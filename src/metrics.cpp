@@ -0,0 +1,221 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <time.h>
+
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTimer>
+
+#include "metrics.h"
+
+using namespace KAnalytics;
+
+namespace {
+struct Registry {
+    QMutex mutex;
+    QList<Counter *> counters;
+    QList<LatencyHistogram *> histograms;
+    std::atomic<unsigned> nextShard;
+
+    Registry() : nextShard(0) {}
+};
+}
+
+Q_GLOBAL_STATIC(Registry, registry)
+
+unsigned KAnalytics::nextMetricsShard()
+{
+    return registry()->nextShard.fetch_add(1, std::memory_order_relaxed);
+}
+
+Counter::Counter(const QString &name)
+    : m_name(name)
+{
+    for (int i = 0; i < MetricsShards; ++i) {
+        m_shards[i].value.store(0, std::memory_order_relaxed);
+    }
+
+    QMutexLocker locker(&registry()->mutex);
+    registry()->counters.append(this);
+}
+
+Counter::~Counter()
+{
+    if (!registry.isDestroyed()) {
+        QMutexLocker locker(&registry()->mutex);
+        registry()->counters.removeOne(this);
+    }
+}
+
+QString Counter::name() const
+{
+    return m_name;
+}
+
+quint64 Counter::take()
+{
+    quint64 sum = 0;
+    for (int i = 0; i < MetricsShards; ++i) {
+        sum += m_shards[i].value.exchange(0, std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+LatencyHistogram::LatencyHistogram(const QString &name)
+    : m_name(name)
+{
+    for (int i = 0; i < MetricsShards; ++i) {
+        for (int j = 0; j <= Buckets; ++j) {
+            m_shards[i].counts[j].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    QMutexLocker locker(&registry()->mutex);
+    registry()->histograms.append(this);
+}
+
+LatencyHistogram::~LatencyHistogram()
+{
+    if (!registry.isDestroyed()) {
+        QMutexLocker locker(&registry()->mutex);
+        registry()->histograms.removeOne(this);
+    }
+}
+
+QString LatencyHistogram::name() const
+{
+    return m_name;
+}
+
+QVector<quint64> LatencyHistogram::take()
+{
+    QVector<quint64> counts(Buckets + 1, 0);
+    for (int i = 0; i < MetricsShards; ++i) {
+        for (int j = 0; j <= Buckets; ++j) {
+            counts[j] += m_shards[i].counts[j].exchange(0, std::memory_order_relaxed);
+        }
+    }
+    return counts;
+}
+
+QVector<double> LatencyHistogram::bounds()
+{
+    QVector<double> bounds;
+    bounds.reserve(Buckets);
+    for (int i = 0; i < Buckets; ++i) {
+        bounds.append(double(quint64(1) << i));
+    }
+    return bounds;
+}
+
+static quint64 monotonicNsecs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return quint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+LatencyTimer::LatencyTimer(LatencyHistogram *histogram)
+    : m_histogram(histogram), m_start(monotonicNsecs())
+{
+}
+
+LatencyTimer::~LatencyTimer()
+{
+    m_histogram->record(monotonicNsecs() - m_start);
+}
+
+void Metrics::flush()
+{
+    // objects can share a name, e.g. a static counter in a header; their values add up
+    QHash<QString, quint64> counts;
+    QHash<QString, QVector<quint64> > bucketCounts;
+    {
+        QMutexLocker locker(&registry()->mutex);
+        foreach (Counter *counter, registry()->counters) {
+            const quint64 count = counter->take();
+            if (count) {
+                counts[counter->name()] += count;
+            }
+        }
+        foreach (LatencyHistogram *histogram, registry()->histograms) {
+            const QVector<quint64> taken = histogram->take();
+            if (std::count(taken.constBegin(), taken.constEnd(), quint64(0)) == taken.count()) {
+                continue;
+            }
+            QVector<quint64> &sum = bucketCounts[histogram->name()];
+            sum.resize(taken.count());
+            for (int i = 0; i < taken.count(); ++i) {
+                sum[i] += taken.at(i);
+            }
+        }
+    }
+
+    QJsonObject counters;
+    for (QHash<QString, quint64>::const_iterator it = counts.constBegin(); it != counts.constEnd(); ++it) {
+        counters.insert(it.key(), double(it.value()));
+    }
+    QJsonObject latencies;
+    for (QHash<QString, QVector<quint64> >::const_iterator it = bucketCounts.constBegin(); it != bucketCounts.constEnd(); ++it) {
+        QJsonArray array;
+        foreach (quint64 count, it.value()) {
+            array.append(double(count));
+        }
+        latencies.insert(it.key(), array);
+    }
+
+    if (counters.isEmpty() && latencies.isEmpty()) {
+        return;
+    }
+
+    QJsonObject obj;
+    obj.insert("counters", counters);
+    obj.insert("latencies", latencies);
+
+    // fire and forget, the application shouldn't wait for kded
+    QDBusMessage msg = QDBusMessage::createMethodCall(QStringLiteral("org.kde.kded5"), QStringLiteral("/modules/kanalytics"),
+                                                      QStringLiteral("org.kde.analytics"), QStringLiteral("submitMetrics"));
+    msg << QCoreApplication::applicationName() << QString::fromUtf8(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+    QDBusConnection::sessionBus().send(msg);
+}
+
+void Metrics::enableFlushing(int msecs)
+{
+    static QTimer *timer = 0;
+    if (!timer) {
+        timer = new QTimer(QCoreApplication::instance());
+        timer->setTimerType(Qt::VeryCoarseTimer);
+        QObject::connect(timer, &QTimer::timeout, &Metrics::flush);
+        QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, &Metrics::flush);
+    }
+    timer->start(msecs);
+}
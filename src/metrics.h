@@ -0,0 +1,184 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+
+#include <QString>
+#include <QVector>
+
+namespace KAnalytics {
+
+/**
+ * @internal the shard used by the calling thread; threads are spread over the
+ * shards round-robin so that concurrent updates rarely hit the same cache line
+ */
+Q_DECL_EXPORT unsigned nextMetricsShard();
+
+inline unsigned currentMetricsShard()
+{
+    static thread_local unsigned shard = nextMetricsShard();
+    return shard;
+}
+
+enum { MetricsShards = 16 }; // power of two
+
+/**
+ * Application counter
+ *
+ * Counts events in an application, e.g. files opened. Meant to be created once,
+ * typically as a static, and updated from hot paths: add() is a relaxed atomic
+ * increment on a per-thread, cache-line sized slot and costs a few nanoseconds.
+ *
+ * The counts are sent to the KAnalytics service by Metrics::flush() and become
+ * part of its next export.
+ */
+class Q_DECL_EXPORT Counter
+{
+public:
+    explicit Counter(const QString &name);
+    ~Counter();
+
+    /**
+     * Add @p n to the counter
+     */
+    void add(quint64 n = 1)
+    {
+        m_shards[currentMetricsShard() & (MetricsShards - 1)].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    /**
+     * @return the counter's name
+     */
+    QString name() const;
+
+    /**
+     * @return the count since the last call, resetting it to zero
+     */
+    quint64 take();
+
+private:
+    Q_DISABLE_COPY(Counter)
+
+    struct alignas(64) Shard {
+        std::atomic<quint64> value;
+    };
+
+    QString m_name;
+    Shard m_shards[MetricsShards];
+};
+
+/**
+ * Application latency histogram
+ *
+ * Records durations, e.g. the time it takes to open a file or render a frame,
+ * in power of two buckets from 1 ns to about 9 minutes. Like Counter, record()
+ * only touches the calling thread's slot and is cheap enough for hot paths.
+ */
+class Q_DECL_EXPORT LatencyHistogram
+{
+public:
+    enum { Buckets = 40 }; ///< plus one overflow bucket
+
+    explicit LatencyHistogram(const QString &name);
+    ~LatencyHistogram();
+
+    /**
+     * Record a duration of @p nsecs nanoseconds
+     */
+    void record(quint64 nsecs)
+    {
+        // bucket i holds (2^(i-1), 2^i]
+        const unsigned bucket = nsecs <= 1 ? 0 : qMin<unsigned>(64 - __builtin_clzll(nsecs - 1), Buckets);
+        m_shards[currentMetricsShard() & (MetricsShards - 1)].counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @return the histogram's name
+     */
+    QString name() const;
+
+    /**
+     * @return the bucket counts since the last call, resetting them to zero
+     */
+    QVector<quint64> take();
+
+    /**
+     * @return the upper bounds of the buckets, in nanoseconds
+     */
+    static QVector<double> bounds();
+
+private:
+    Q_DISABLE_COPY(LatencyHistogram)
+
+    struct alignas(64) Shard {
+        std::atomic<quint64> counts[Buckets + 1];
+    };
+
+    QString m_name;
+    Shard m_shards[MetricsShards];
+};
+
+/**
+ * Measures the time between its construction and destruction into a LatencyHistogram
+ */
+class Q_DECL_EXPORT LatencyTimer
+{
+public:
+    explicit LatencyTimer(LatencyHistogram *histogram);
+    ~LatencyTimer();
+
+private:
+    Q_DISABLE_COPY(LatencyTimer)
+    LatencyHistogram *m_histogram;
+    quint64 m_start;
+};
+
+/**
+ * Application metrics
+ *
+ * Sends what the application's Counter and LatencyHistogram objects recorded
+ * to the KAnalytics kded service over D-Bus. Objects with the same name are
+ * summed up. Every flush() resets the recorded values: while the service isn't
+ * running, or the user didn't approve exporting data, they are dropped rather
+ * than kept for later.
+ */
+class Q_DECL_EXPORT Metrics
+{
+public:
+    /**
+     * Send and reset the recorded values, identifying the application by
+     * QCoreApplication::applicationName()
+     */
+    static void flush();
+
+    /**
+     * Call flush() every @p msecs milliseconds and when the application quits.
+     * Must be called from the main thread once the QCoreApplication exists.
+     */
+    static void enableFlushing(int msecs = 5 * 60 * 1000);
+};
+
+}
+
+#endif // METRICS_H
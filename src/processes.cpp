@@ -0,0 +1,257 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "processes.h"
+#include "sysfs.h"
+
+using namespace KAnalytics;
+
+static const qint64 RESCAN_INTERVAL = 60 * 1000; // msec
+static const int PSS_EVERY = 6; // read smaps_rollup every n-th sample only
+
+static QVector<double> cpuBounds()
+{
+    return QVector<double>() << 0.5 << 1 << 2 << 5 << 10 << 25 << 50 << 100 << 200 << 400;
+}
+
+static QVector<double> memoryBounds()
+{
+    return QVector<double>() << 16 << 32 << 64 << 128 << 256 << 512 << 1024 << 2048 << 4096;
+}
+
+bool KAnalytics::parseStatTicks(const char *stat, quint64 *ticks)
+{
+    // the comm field may contain spaces and parentheses, the fields we want
+    // (utime and stime, 14 and 15) are counted from the last ')'
+    const char *pos = strrchr(stat, ')');
+    if (!pos) {
+        return false;
+    }
+    ++pos;
+    for (int field = 2; field < 13 && pos; ++field) { // skip to the space before utime
+        pos = strchr(pos + 1, ' ');
+    }
+    if (!pos) {
+        return false;
+    }
+    char *end;
+    const quint64 utime = strtoull(pos, &end, 10);
+    const quint64 stime = strtoull(end, 0, 10);
+    *ticks = utime + stime;
+    return true;
+}
+
+static void addValue(QHash<QString, Histogram> *histograms, const QString &name, const QVector<double> &bounds, double value)
+{
+    QHash<QString, Histogram>::iterator it = histograms->find(name);
+    if (it == histograms->end()) {
+        it = histograms->insert(name, Histogram(bounds));
+    }
+    it->add(value);
+}
+
+static QJsonObject percentiles(const Histogram &histogram)
+{
+    QJsonObject obj;
+    obj.insert("p50", histogram.percentile(50));
+    obj.insert("p90", histogram.percentile(90));
+    obj.insert("p99", histogram.percentile(99));
+    return obj;
+}
+
+ProcessMonitor::ProcessMonitor(const QStringList &names)
+    : m_names(names),
+      m_procFd(openSysDirectory("/proc")),
+      m_lastScan(0),
+      m_rescanNeeded(true),
+      m_sampleCount(0),
+      m_ticksPerSecond(sysconf(_SC_CLK_TCK)),
+      m_pageSize(sysconf(_SC_PAGESIZE))
+{
+    m_clock.start();
+}
+
+ProcessMonitor::~ProcessMonitor()
+{
+    foreach (const Process &process, m_processes) {
+        closeProcess(process);
+    }
+    if (m_procFd >= 0) {
+        ::close(m_procFd);
+    }
+}
+
+QStringList ProcessMonitor::defaultNames()
+{
+    return QStringList() << QStringLiteral("plasmashell") << QStringLiteral("kwin_*")
+                         << QStringLiteral("kded5") << QStringLiteral("baloo_file*");
+}
+
+bool ProcessMonitor::matches(const QByteArray &comm) const
+{
+    const QString name = QString::fromLocal8Bit(comm);
+    foreach (const QString &pattern, m_names) {
+        if (pattern.endsWith(QLatin1Char('*')) ? name.startsWith(pattern.left(pattern.size() - 1)) : name == pattern) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ProcessMonitor::closeProcess(const Process &process)
+{
+    ::close(process.statFd);
+    ::close(process.statmFd);
+    if (process.smapsFd >= 0) {
+        ::close(process.smapsFd);
+    }
+}
+
+void ProcessMonitor::rescan()
+{
+    m_lastScan = m_clock.elapsed();
+    m_rescanNeeded = false;
+
+    QVector<int> known;
+    foreach (const Process &process, m_processes) {
+        known.append(process.pid);
+    }
+
+    forEachSubdirectory(m_procFd, "", [&](int pidFd, const char *name) {
+        if (name[0] < '1' || name[0] > '9') { // only the numeric PID directories
+            return;
+        }
+
+        const int pid = atoi(name);
+        if (known.contains(pid)) {
+            return;
+        }
+
+        const QByteArray comm = readSysFileAt(pidFd, "comm", 64);
+        if (matches(comm)) {
+            Process process;
+            process.name = QString::fromLocal8Bit(comm);
+            process.pid = pid;
+            process.statFd = ::openat(pidFd, "stat", O_RDONLY | O_CLOEXEC);
+            process.statmFd = ::openat(pidFd, "statm", O_RDONLY | O_CLOEXEC);
+            process.smapsFd = ::openat(pidFd, "smaps_rollup", O_RDONLY | O_CLOEXEC); // Linux 4.14+
+            process.cpuTicks = 0;
+            process.sampledAt = -1;
+            if (process.statFd >= 0 && process.statmFd >= 0) {
+                m_processes.append(process);
+            } else {
+                closeProcess(process);
+            }
+        }
+    });
+}
+
+bool ProcessMonitor::sampleProcess(Process *process, bool withPss)
+{
+    char buf[1024];
+
+    quint64 ticks;
+    if (!preadFile(process->statFd, buf, sizeof(buf)) || !parseStatTicks(buf, &ticks)) {
+        return false; // the process is gone
+    }
+    const qint64 now = m_clock.elapsed();
+
+    if (process->sampledAt >= 0 && now > process->sampledAt && m_ticksPerSecond > 0) {
+        const double seconds = (now - process->sampledAt) / 1000.0;
+        addValue(&m_cpu, process->name, cpuBounds(), (ticks - process->cpuTicks) * 100.0 / m_ticksPerSecond / seconds);
+    }
+    process->cpuTicks = ticks;
+    process->sampledAt = now;
+
+    // "size resident shared text lib data dt", in pages
+    if (!preadFile(process->statmFd, buf, sizeof(buf))) {
+        return false;
+    }
+    const char *resident = strchr(buf, ' ');
+    if (resident) {
+        addValue(&m_rss, process->name, memoryBounds(), strtoull(resident, 0, 10) * m_pageSize / (1024.0 * 1024.0));
+    }
+
+    if (withPss && process->smapsFd >= 0) {
+        char smaps[4096];
+        if (preadFile(process->smapsFd, smaps, sizeof(smaps))) {
+            const char *pss = strstr(smaps, "\nPss:");
+            if (pss) {
+                addValue(&m_pss, process->name, memoryBounds(), strtoull(pss + 5, 0, 10) / 1024.0); // in kB
+            }
+        }
+    }
+
+    return true;
+}
+
+void ProcessMonitor::sample()
+{
+    if (m_procFd < 0) {
+        return;
+    }
+
+    if (m_rescanNeeded || m_clock.elapsed() - m_lastScan >= RESCAN_INTERVAL) {
+        rescan();
+    }
+
+    const bool withPss = (m_sampleCount++ % PSS_EVERY) == 0;
+    for (int i = 0; i < m_processes.size();) {
+        if (sampleProcess(&m_processes[i], withPss)) {
+            ++i;
+        } else {
+            closeProcess(m_processes.at(i));
+            m_processes.remove(i);
+            m_rescanNeeded = true; // it might have been restarted
+        }
+    }
+}
+
+QJsonObject ProcessMonitor::toJson() const
+{
+    QJsonObject obj;
+    QHash<QString, Histogram>::const_iterator it;
+    for (it = m_rss.constBegin(); it != m_rss.constEnd(); ++it) {
+        QJsonObject processObj;
+        processObj.insert("samples", double(it->count()));
+        processObj.insert("rss", percentiles(*it));
+        if (m_cpu.contains(it.key())) {
+            processObj.insert("cpu", percentiles(m_cpu.value(it.key())));
+        }
+        if (m_pss.contains(it.key())) {
+            processObj.insert("pss", percentiles(m_pss.value(it.key())));
+        }
+        obj.insert(it.key(), processObj);
+    }
+    return obj;
+}
+
+void ProcessMonitor::clear()
+{
+    m_cpu.clear();
+    m_rss.clear();
+    m_pss.clear();
+}
@@ -0,0 +1,120 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PROCESSES_H
+#define PROCESSES_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QStringList>
+#include <QVector>
+
+#include "histogram.h"
+
+namespace KAnalytics {
+
+/**
+ * Parse the contents of a /proc/<pid>/stat file.
+ *
+ * @return false if @p stat is malformed, otherwise the sum of the utime and
+ * stime fields (in clock ticks) in @p ticks
+ */
+Q_DECL_EXPORT bool parseStatTicks(const char *stat, quint64 *ticks);
+
+/**
+ * Resource profile of desktop processes
+ *
+ * Tracks the CPU use, RSS and PSS of the processes whose name matches one of the
+ * configured names ("kwin_*" matches by prefix). Their /proc/<pid>/stat and statm
+ * files are opened once and re-read with pread(); CPU use is the delta of the
+ * utime and stime counters between two samples. smaps_rollup, which is costlier
+ * for the kernel to produce, is only read every few samples. /proc is only
+ * rescanned once a minute or when a tracked process goes away.
+ *
+ * The samples are kept in per-process histograms, the report contains their percentiles.
+ */
+class Q_DECL_EXPORT ProcessMonitor
+{
+public:
+    /**
+     * Track processes matching any of @p names
+     */
+    explicit ProcessMonitor(const QStringList &names);
+    ~ProcessMonitor();
+
+    /**
+     * @return the names tracked by default: Plasma, KWin, KDED and Baloo
+     */
+    static QStringList defaultNames();
+
+    /**
+     * Sample all the tracked processes
+     */
+    void sample();
+
+    /**
+     * @return the 50th, 90th and 99th percentiles of each tracked process' CPU use
+     * (in percent of one CPU), RSS and PSS (in MiB) as a QJsonObject
+     */
+    QJsonObject toJson() const;
+
+    /**
+     * Drop the recorded samples, e.g. after they were exported
+     */
+    void clear();
+
+private:
+    Q_DISABLE_COPY(ProcessMonitor)
+
+    struct Process {
+        QString name;
+        int pid;
+        int statFd;
+        int statmFd;
+        int smapsFd;
+        quint64 cpuTicks; // utime + stime at the last sample
+        qint64 sampledAt; // msecs on m_clock at the last sample
+    };
+
+    bool matches(const QByteArray &comm) const;
+    void rescan();
+    bool sampleProcess(Process *process, bool withPss);
+    static void closeProcess(const Process &process);
+
+    QStringList m_names;
+    QVector<Process> m_processes;
+    int m_procFd;
+    QElapsedTimer m_clock;
+    qint64 m_lastScan;
+    bool m_rescanNeeded;
+    quint64 m_sampleCount;
+    long m_ticksPerSecond;
+    long m_pageSize;
+
+    QHash<QString, Histogram> m_cpu;
+    QHash<QString, Histogram> m_rss;
+    QHash<QString, Histogram> m_pss;
+};
+
+}
+
+#endif // PROCESSES_H
@@ -0,0 +1,113 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <atomic>
+
+namespace KAnalytics {
+
+/**
+ * Fixed-size lock-free ring buffer
+ *
+ * Safe for exactly one producer thread calling push() and one consumer
+ * thread calling pop() at the same time. The storage is allocated once,
+ * as part of the object; when the buffer is full push() drops the item.
+ *
+ * @p Capacity must be a power of two.
+ */
+template <typename T, unsigned Capacity>
+class RingBuffer
+{
+    static_assert(Capacity && !(Capacity & (Capacity - 1)), "Capacity must be a power of two");
+
+public:
+    RingBuffer()
+        : m_head(0), m_tail(0), m_dropped(0)
+    {
+    }
+
+    /**
+     * Append @p item, returns false (and drops it) if the buffer is full
+     */
+    bool push(const T &item)
+    {
+        const unsigned head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == Capacity) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_items[head & (Capacity - 1)] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Take the oldest item into @p item, returns false if the buffer is empty
+     */
+    bool pop(T *item)
+    {
+        const unsigned tail = m_tail.load(std::memory_order_relaxed);
+        if (m_head.load(std::memory_order_acquire) == tail) {
+            return false;
+        }
+        *item = m_items[tail & (Capacity - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @return the number of items currently in the buffer
+     */
+    unsigned size() const
+    {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @return the maximum number of items the buffer holds
+     */
+    static unsigned capacity()
+    {
+        return Capacity;
+    }
+
+    /**
+     * @return the number of items push() had to drop so far
+     */
+    unsigned dropped() const
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    T m_items[Capacity];
+    // no cache line padding between head and tail: the buffer lives on the heap,
+    // where new doesn't honour over-alignment before C++17
+    std::atomic<unsigned> m_head;
+    std::atomic<unsigned> m_tail;
+    std::atomic<unsigned> m_dropped;
+};
+
+}
+
+#endif // RINGBUFFER_H
@@ -0,0 +1,223 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <QFile>
+#include <qnumeric.h>
+
+#include "backend.h"
+#include "sampler.h"
+#include "sysfs.h"
+
+using namespace KAnalytics;
+
+static QVector<double> loadBounds()
+{
+    return QVector<double>() << 0.1 << 0.25 << 0.5 << 0.75 << 1 << 1.5 << 2 << 4;
+}
+
+static QVector<double> percentBounds()
+{
+    return QVector<double>() << 5 << 10 << 20 << 30 << 40 << 50 << 60 << 70 << 80 << 90 << 100;
+}
+
+static QVector<double> pressureBounds()
+{
+    return QVector<double>() << 0 << 1 << 5 << 10 << 25 << 50 << 100;
+}
+
+static int openProcFile(const char *path)
+{
+    return ::open(QFile::encodeName(sysPath(path)).constData(), O_RDONLY | O_CLOEXEC);
+}
+
+// The number following @p key in @p buf, e.g. "MemTotal:" in /proc/meminfo
+static double valueAfter(const char *buf, const char *key)
+{
+    const char *pos = strstr(buf, key);
+    if (!pos) {
+        return qQNaN();
+    }
+
+    return strtod(pos + strlen(key), 0);
+}
+
+static float readPressure(int fd)
+{
+    char buf[256];
+    if (!preadFile(fd, buf, sizeof(buf))) {
+        return qQNaN();
+    }
+
+    // "some avg10=0.00 avg60=0.00 avg300=0.00 total=0"
+    return valueAfter(buf, "some avg10=");
+}
+
+Sampler::Sampler()
+    : m_loadFd(openProcFile("/proc/loadavg")),
+      m_memInfoFd(openProcFile("/proc/meminfo")),
+      m_cpuPressureFd(openProcFile("/proc/pressure/cpu")),
+      m_memoryPressureFd(openProcFile("/proc/pressure/memory")),
+      m_ioPressureFd(openProcFile("/proc/pressure/io")),
+      m_numCpus(Backend::instance()->onlineCpus()),
+      m_load(loadBounds()),
+      m_memoryAvailable(percentBounds()),
+      m_swapUsed(percentBounds()),
+      m_cpuPressure(pressureBounds()),
+      m_memoryPressure(pressureBounds()),
+      m_ioPressure(pressureBounds())
+{
+}
+
+Sampler::~Sampler()
+{
+    const int fds[] = { m_loadFd, m_memInfoFd, m_cpuPressureFd, m_memoryPressureFd, m_ioPressureFd };
+    for (unsigned i = 0; i < sizeof(fds) / sizeof(fds[0]); ++i) {
+        if (fds[i] >= 0) {
+            ::close(fds[i]);
+        }
+    }
+}
+
+Sampler::Sample Sampler::sample() const
+{
+    Sample sample;
+
+    char buf[4096];
+    if (preadFile(m_loadFd, buf, sizeof(buf))) {
+        sample.loadPerCpu = strtod(buf, 0) / m_numCpus;
+    } else {
+        sample.loadPerCpu = qQNaN();
+    }
+
+    sample.memoryAvailable = qQNaN();
+    sample.swapUsed = qQNaN();
+    if (preadFile(m_memInfoFd, buf, sizeof(buf))) {
+        const double memTotal = valueAfter(buf, "MemTotal:");
+        const double memAvailable = valueAfter(buf, "MemAvailable:");
+        if (memTotal > 0 && !qIsNaN(memAvailable)) {
+            sample.memoryAvailable = memAvailable * 100 / memTotal;
+        }
+        const double swapTotal = valueAfter(buf, "SwapTotal:");
+        const double swapFree = valueAfter(buf, "SwapFree:");
+        if (swapTotal > 0 && !qIsNaN(swapFree)) { // no swap means no swap use to report
+            sample.swapUsed = (swapTotal - swapFree) * 100 / swapTotal;
+        }
+    }
+
+    sample.cpuPressure = readPressure(m_cpuPressureFd);
+    sample.memoryPressure = readPressure(m_memoryPressureFd);
+    sample.ioPressure = readPressure(m_ioPressureFd);
+
+    return sample;
+}
+
+static void insertValue(QJsonObject *obj, const char *key, float value)
+{
+    if (!qIsNaN(value)) {
+        obj->insert(key, value);
+    }
+}
+
+QJsonObject Sampler::sampleToJson(const Sample &sample)
+{
+    QJsonObject obj;
+    insertValue(&obj, "loadPerCpu", sample.loadPerCpu);
+    insertValue(&obj, "memoryAvailable", sample.memoryAvailable);
+    insertValue(&obj, "swapUsed", sample.swapUsed);
+    insertValue(&obj, "cpuPressure", sample.cpuPressure);
+    insertValue(&obj, "memoryPressure", sample.memoryPressure);
+    insertValue(&obj, "ioPressure", sample.ioPressure);
+    return obj;
+}
+
+bool Sampler::record()
+{
+    const bool queued = m_queue.push(sample());
+    if (m_queue.size() >= FoldThreshold) {
+        fold();
+    }
+    return queued;
+}
+
+static void addValue(Histogram *histogram, float value)
+{
+    if (!qIsNaN(value)) {
+        histogram->add(value);
+    }
+}
+
+void Sampler::fold()
+{
+    Sample sample;
+    while (m_queue.pop(&sample)) {
+        addValue(&m_load, sample.loadPerCpu);
+        addValue(&m_memoryAvailable, sample.memoryAvailable);
+        addValue(&m_swapUsed, sample.swapUsed);
+        addValue(&m_cpuPressure, sample.cpuPressure);
+        addValue(&m_memoryPressure, sample.memoryPressure);
+        addValue(&m_ioPressure, sample.ioPressure);
+    }
+}
+
+quint64 Sampler::count() const
+{
+    return m_load.count();
+}
+
+unsigned Sampler::pending() const
+{
+    return m_queue.size();
+}
+
+QJsonObject Sampler::toJson()
+{
+    fold();
+
+    QJsonObject obj;
+    obj.insert("samples", double(count()));
+    obj.insert("loadPerCpu", m_load.toJson());
+    obj.insert("memoryAvailable", m_memoryAvailable.toJson());
+    if (m_swapUsed.count()) {
+        obj.insert("swapUsed", m_swapUsed.toJson());
+    }
+    if (m_cpuPressure.count()) { // PSI needs Linux 4.20 and CONFIG_PSI
+        obj.insert("cpuPressure", m_cpuPressure.toJson());
+        obj.insert("memoryPressure", m_memoryPressure.toJson());
+        obj.insert("ioPressure", m_ioPressure.toJson());
+    }
+    return obj;
+}
+
+void Sampler::clear()
+{
+    fold();
+    m_load.clear();
+    m_memoryAvailable.clear();
+    m_swapUsed.clear();
+    m_cpuPressure.clear();
+    m_memoryPressure.clear();
+    m_ioPressure.clear();
+}
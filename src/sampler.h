@@ -0,0 +1,129 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <QJsonObject>
+
+#include "histogram.h"
+#include "ringbuffer.h"
+
+namespace KAnalytics {
+
+/**
+ * System metrics sampler
+ *
+ * Periodically samples the load, memory availability, swap use and pressure stall
+ * information (PSI) of the system. The /proc files are opened once and re-read
+ * with pread(), so a sample costs a handful of syscalls and no allocations.
+ *
+ * Samples are queued in a fixed-size lock-free ring buffer and folded into
+ * histograms, which is what ends up in the report; the host just calls
+ * record() from a timer.
+ */
+class Q_DECL_EXPORT Sampler
+{
+public:
+    /**
+     * One sample; values that are unavailable on this system are NaN
+     */
+    struct Sample {
+        float loadPerCpu;      ///< 1 minute load average divided by the number of online CPUs
+        float memoryAvailable; ///< MemAvailable in percent of MemTotal
+        float swapUsed;        ///< used swap in percent of SwapTotal
+        float cpuPressure;     ///< PSI "some" avg10 of the CPU, in percent
+        float memoryPressure;  ///< PSI "some" avg10 of the memory, in percent
+        float ioPressure;      ///< PSI "some" avg10 of the I/O, in percent
+    };
+
+    Sampler();
+    ~Sampler();
+
+    /**
+     * @return a sample of the current state of the system
+     */
+    Sample sample() const;
+
+    /**
+     * @return @p sample as a QJsonObject, unavailable values are left out
+     */
+    static QJsonObject sampleToJson(const Sample &sample);
+
+    /**
+     * Take a sample and queue it, returns false if the queue was full
+     */
+    bool record();
+
+    /**
+     * Fold the queued samples into the histograms
+     */
+    void fold();
+
+    /**
+     * @return the number of samples folded into the histograms so far
+     */
+    quint64 count() const;
+
+    /**
+     * @return the histograms of all the samples recorded since the last clear()
+     * as a QJsonObject
+     */
+    QJsonObject toJson();
+
+    /**
+     * Drop the recorded samples, e.g. after they were exported
+     */
+    void clear();
+
+    /**
+     * Samples are folded when the queue is this full
+     */
+    enum { FoldThreshold = 128 };
+
+    /**
+     * @return the number of samples waiting in the queue
+     */
+    unsigned pending() const;
+
+private:
+    Q_DISABLE_COPY(Sampler)
+
+    int m_loadFd;
+    int m_memInfoFd;
+    int m_cpuPressureFd;
+    int m_memoryPressureFd;
+    int m_ioPressureFd;
+    int m_numCpus;
+
+    RingBuffer<Sample, 256> m_queue;
+
+    Histogram m_load;
+    Histogram m_memoryAvailable;
+    Histogram m_swapUsed;
+    Histogram m_cpuPressure;
+    Histogram m_memoryPressure;
+    Histogram m_ioPressure;
+};
+
+}
+
+#endif // SAMPLER_H
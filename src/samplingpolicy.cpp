@@ -0,0 +1,70 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "samplingpolicy.h"
+#include "state.h"
+
+using namespace KAnalytics;
+
+SamplingPolicy::SamplingPolicy()
+    : m_rate(1.0)
+{
+}
+
+SamplingPolicy SamplingPolicy::load(const QDateTime &now)
+{
+    SamplingPolicy policy;
+    const State *state = State::instance();
+    const QDateTime received = state->value(QStringLiteral("samplingTime")).toDateTime();
+    if (received.isValid() && received.daysTo(now) < MaxAge) { // one stored without a time counts as expired
+        policy.m_rate = state->value(QStringLiteral("samplingRate"), 1.0).toDouble();
+        policy.m_sections = state->value(QStringLiteral("samplingSections")).toStringList();
+    }
+    return policy;
+}
+
+void SamplingPolicy::store(const QByteArray &reply, const QDateTime &now)
+{
+    State *state = State::instance();
+    const QJsonObject policy = QJsonDocument::fromJson(reply).object().value("sampling").toObject();
+    if (policy.isEmpty()) {
+        state->remove(QStringLiteral("samplingRate"));
+        state->remove(QStringLiteral("samplingSections"));
+        state->remove(QStringLiteral("samplingTime"));
+    } else {
+        state->setValue(QStringLiteral("samplingRate"), qBound(0.0, policy.value("rate").toDouble(1.0), 1.0));
+        state->setValue(QStringLiteral("samplingSections"), policy.value("sections").toVariant().toStringList());
+        state->setValue(QStringLiteral("samplingTime"), now);
+    }
+}
+
+bool SamplingPolicy::includes(int bucket) const
+{
+    return bucket < m_rate * 10000;
+}
+
+QStringList SamplingPolicy::sections() const
+{
+    return m_sections;
+}
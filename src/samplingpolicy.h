@@ -0,0 +1,79 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SAMPLINGPOLICY_H
+#define SAMPLINGPOLICY_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QStringList>
+
+namespace KAnalytics {
+
+/**
+ * Sampling policy for scheduled exports
+ *
+ * The server sends it along with its reply to a successful upload, e.g.
+ * {"sampling": {"rate": 0.1, "sections": ["system", "KDE"]}}: only a share of
+ * the machines export, and only the listed sections. It's kept in the State.
+ *
+ * A machine outside the sample, or without changes to the requested sections,
+ * doesn't upload and so doesn't hear about a new policy; that's why a policy
+ * only applies for MaxAge days. After that the next scheduled export sends
+ * everything again and gets the current policy with the reply.
+ */
+class Q_DECL_EXPORT SamplingPolicy
+{
+public:
+    enum { MaxAge = 28 }; ///< days
+
+    /**
+     * @return the stored policy; everything is sent if there is none or it's
+     * older than MaxAge days at @p now
+     */
+    static SamplingPolicy load(const QDateTime &now);
+
+    /**
+     * Replace the stored policy with the one in the server's @p reply, received
+     * at @p now; a reply without one means everything is sent
+     */
+    static void store(const QByteArray &reply, const QDateTime &now);
+
+    /**
+     * @return whether the machine in @p bucket, in [0, 10000), is part of the sample
+     */
+    bool includes(int bucket) const;
+
+    /**
+     * @return the sections to export, empty for all of them
+     */
+    QStringList sections() const;
+
+private:
+    SamplingPolicy();
+
+    double m_rate;
+    QStringList m_sections;
+};
+
+}
+
+#endif // SAMPLINGPOLICY_H
@@ -0,0 +1,47 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "snapshot.h"
+
+using namespace KAnalytics;
+
+Snapshot::Snapshot(const QJsonObject &report, const QDateTime &timestamp)
+    : m_report(report), m_timestamp(timestamp)
+{
+    // serialize once up front, readers only ever get copies of these
+    const QJsonDocument doc(m_report);
+    m_indented = doc.toJson(QJsonDocument::Indented);
+    m_compact = doc.toJson(QJsonDocument::Compact);
+}
+
+QJsonObject Snapshot::report() const
+{
+    return m_report;
+}
+
+QDateTime Snapshot::timestamp() const
+{
+    return m_timestamp;
+}
+
+QByteArray Snapshot::toJson(QJsonDocument::JsonFormat format) const
+{
+    return format == QJsonDocument::Compact ? m_compact : m_indented;
+}
@@ -0,0 +1,73 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSharedPointer>
+
+namespace KAnalytics {
+
+/**
+ * KAnalytics Snapshot
+ *
+ * An immutable, already serialized analytics report. Snapshots are handed around
+ * as Snapshot::Ptr so that any number of readers can share one collection result;
+ * publishing a newer report means swapping the pointer, never modifying a snapshot.
+ */
+class Q_DECL_EXPORT Snapshot
+{
+public:
+    typedef QSharedPointer<const Snapshot> Ptr;
+
+    /**
+     * Create a snapshot of the @p report collected at @p timestamp
+     */
+    explicit Snapshot(const QJsonObject &report, const QDateTime &timestamp = QDateTime::currentDateTime());
+
+    /**
+     * @return the report this snapshot was created from
+     */
+    QJsonObject report() const;
+
+    /**
+     * @return the time the report was collected
+     */
+    QDateTime timestamp() const;
+
+    /**
+     * @return the report serialized as JSON in the given @p format
+     */
+    QByteArray toJson(QJsonDocument::JsonFormat format = QJsonDocument::Indented) const;
+
+private:
+    QJsonObject m_report;
+    QDateTime m_timestamp;
+    QByteArray m_indented;
+    QByteArray m_compact;
+};
+
+}
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,259 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUuid>
+#include <QDebug>
+
+#include <KSharedConfig>
+#include <KConfigGroup>
+
+#include "state.h"
+
+using namespace KAnalytics;
+
+static const quint32 STATE_MAGIC = 0x4b415354; // "KAST"
+static const quint32 STATE_VERSION = 1;
+static const int COMMIT_WINDOW = 2000; // msec
+
+State *State::instance()
+{
+    static State state; // its destructor commits what's still pending at exit
+    return &state;
+}
+
+State::State()
+    : m_dirty(false), m_readOnly(false)
+{
+    m_commitTimer.setSingleShot(true);
+    m_commitTimer.setInterval(COMMIT_WINDOW);
+    connect(&m_commitTimer, &QTimer::timeout, this, &State::commit);
+
+    load();
+}
+
+State::~State()
+{
+    commit();
+}
+
+QString State::fileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QStringLiteral("/kanalytics/state");
+}
+
+void State::load()
+{
+    QFile file(fileName());
+    if (!file.exists()) {
+        importConfig();
+        return;
+    }
+
+    // from here on, a file we can't make sense of is left alone: overwriting it
+    // would replace the user's identity and consent answer with new ones
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot read the KAnalytics state file" << file.fileName() << ":" << file.errorString();
+        m_readOnly = true;
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic, version;
+    stream >> magic >> version;
+    if (magic != STATE_MAGIC || version > STATE_VERSION) {
+        qWarning() << "Ignoring unsupported KAnalytics state file" << file.fileName();
+        m_readOnly = true;
+        return;
+    }
+
+    stream >> m_values;
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "Ignoring corrupted KAnalytics state file" << file.fileName();
+        m_values.clear();
+        m_readOnly = true;
+    }
+}
+
+void State::reload()
+{
+    m_commitTimer.stop();
+    m_values.clear();
+    m_dirty = false;
+    m_readOnly = false;
+    load();
+}
+
+// One-time migration from the state earlier versions kept in kanalyticsrc; the
+// migrated keys are removed so that only the user's settings remain in there
+void State::importConfig()
+{
+    if (QStandardPaths::locate(QStandardPaths::GenericConfigLocation, QStringLiteral("kanalyticsrc")).isEmpty()) {
+        return;
+    }
+
+    KSharedConfig::Ptr cfg = KSharedConfig::openConfig("kanalytics");
+    KConfigGroup general(cfg, "General");
+    if (general.hasKey("uuid")) {
+        m_values.insert(QStringLiteral("uuid"), general.readEntry("uuid"));
+    }
+
+    KConfigGroup exportGrp(cfg, "Export");
+    if (exportGrp.hasKey("UserApproval")) {
+        m_values.insert(QStringLiteral("approval"), int(exportGrp.readEntry<bool>("UserApproval", false) ? Approved : Declined));
+    }
+    if (exportGrp.hasKey("Timestamp")) {
+        m_values.insert(QStringLiteral("lastExport"), exportGrp.readEntry<QDateTime>("Timestamp", QDateTime()));
+    }
+    if (exportGrp.hasKey("LastSeenPlasmaVersion")) {
+        m_values.insert(QStringLiteral("lastSeenPlasmaVersion"), exportGrp.readEntry("LastSeenPlasmaVersion"));
+    }
+
+    if (m_values.isEmpty()) {
+        return;
+    }
+
+    // only drop the old copy once the new one is safely on disk
+    m_dirty = true;
+    if (commit()) {
+        cfg->deleteGroup("General");
+        cfg->deleteGroup("Export");
+        cfg->sync();
+    }
+}
+
+QString State::uuid()
+{
+    if (m_readOnly) { // the real one is in the file we couldn't read, don't make up another
+        return QString();
+    }
+
+    QString uuid = m_values.value(QStringLiteral("uuid")).toString();
+    if (uuid.isEmpty()) {
+        //qDebug() << "Creating new UUID";
+        uuid = QUuid::createUuid().toString().remove('{').remove('}');
+        m_values.insert(QStringLiteral("uuid"), uuid);
+        m_dirty = true;
+        commit(); // the identity shouldn't wait for the commit window
+    }
+    return uuid;
+}
+
+State::Approval State::approval() const
+{
+    return static_cast<Approval>(m_values.value(QStringLiteral("approval"), int(NotAsked)).toInt());
+}
+
+void State::setApproval(Approval approval)
+{
+    setValue(QStringLiteral("approval"), int(approval));
+}
+
+QDateTime State::lastExport() const
+{
+    return m_values.value(QStringLiteral("lastExport")).toDateTime();
+}
+
+void State::setLastExport(const QDateTime &timestamp)
+{
+    setValue(QStringLiteral("lastExport"), timestamp);
+}
+
+QString State::lastSeenPlasmaVersion() const
+{
+    return m_values.value(QStringLiteral("lastSeenPlasmaVersion")).toString();
+}
+
+void State::setLastSeenPlasmaVersion(const QString &version)
+{
+    setValue(QStringLiteral("lastSeenPlasmaVersion"), version);
+}
+
+QVariant State::value(const QString &key, const QVariant &defaultValue) const
+{
+    return m_values.value(key, defaultValue);
+}
+
+void State::setValue(const QString &key, const QVariant &value)
+{
+    m_values.insert(key, value);
+    scheduleCommit();
+}
+
+void State::remove(const QString &key)
+{
+    if (m_values.remove(key)) {
+        scheduleCommit();
+    }
+}
+
+void State::scheduleCommit()
+{
+    m_dirty = true;
+    if (!m_commitTimer.isActive()) { // don't push the write out any further
+        m_commitTimer.start();
+    }
+}
+
+bool State::commit()
+{
+    m_commitTimer.stop();
+    if (!m_dirty) {
+        return true;
+    }
+    if (m_readOnly) {
+        return false;
+    }
+
+    const QString path = fileName();
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        qWarning() << "Cannot create the directory of the KAnalytics state" << path;
+        return false;
+    }
+
+    QSaveFile file(path); // written to a temporary file, renamed over the old one on commit()
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write the KAnalytics state to" << path << ":" << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << STATE_MAGIC << STATE_VERSION << m_values;
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        qWarning() << "Cannot write the KAnalytics state to" << path << ":" << file.errorString();
+        return false;
+    }
+
+    m_dirty = false;
+    return true;
+}
+
+bool State::isReadOnly() const
+{
+    return m_readOnly;
+}
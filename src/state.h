@@ -0,0 +1,142 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef STATE_H
+#define STATE_H
+
+#include <QDateTime>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVariant>
+#include <QVariantMap>
+
+namespace KAnalytics {
+
+/**
+ * KAnalytics persistent state
+ *
+ * Everything KAnalytics remembers between runs (the UUID, the user's approval,
+ * export timestamps, histograms, caches...) lives in this one in-memory object.
+ * It is stored as a compact binary file, which is replaced atomically so that a
+ * crash can never leave a half-written state behind. Changes are group committed:
+ * all the changes made within a short window end up in a single write.
+ *
+ * The state is meant to be used from the main thread only.
+ */
+class Q_DECL_EXPORT State : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * The user's answer to exporting data
+     */
+    enum Approval {
+        NotAsked,
+        Approved,
+        Declined
+    };
+
+    /**
+     * @return the process wide state, loaded from disk on first use
+     */
+    static State *instance();
+
+    /**
+     * @return the user's UUID, created (and committed right away) the first time;
+     * empty if the state is read-only
+     */
+    QString uuid();
+
+    /**
+     * @return whether the user approved exporting data
+     */
+    Approval approval() const;
+    void setApproval(Approval approval);
+
+    /**
+     * @return the time of the last successful export, invalid if there was none
+     */
+    QDateTime lastExport() const;
+    void setLastExport(const QDateTime &timestamp);
+
+    /**
+     * @return the Plasma version at the time of the last successful export
+     */
+    QString lastSeenPlasmaVersion() const;
+    void setLastSeenPlasmaVersion(const QString &version);
+
+    /**
+     * @return the value stored under @p key, or @p defaultValue
+     */
+    QVariant value(const QString &key, const QVariant &defaultValue = QVariant()) const;
+
+    /**
+     * Store @p value under @p key; it must be streamable with QDataStream
+     */
+    void setValue(const QString &key, const QVariant &value);
+
+    /**
+     * Remove the value stored under @p key
+     */
+    void remove(const QString &key);
+
+    /**
+     * Write pending changes to disk now instead of at the end of the commit window
+     *
+     * @return false if they couldn't be written
+     */
+    bool commit();
+
+    /**
+     * @return true if the state file exists but couldn't be read, e.g. because it's
+     * corrupted or from a newer version; it's then left untouched and nothing is
+     * committed, changes only live in memory
+     */
+    bool isReadOnly() const;
+
+    /**
+     * Drop the in-memory state, pending changes included, and read the file again
+     */
+    void reload();
+
+    /**
+     * @return the path of the state file
+     */
+    static QString fileName();
+
+    ~State();
+
+private:
+    State();
+    void load();
+    void importConfig();
+    void scheduleCommit();
+
+    QVariantMap m_values;
+    QTimer m_commitTimer;
+    bool m_dirty;
+    bool m_readOnly;
+};
+
+}
+
+#endif // STATE_H
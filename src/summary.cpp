@@ -19,32 +19,23 @@
 */
 
 #include <QJsonObject>
-#include <QUuid>
+#include <QCryptographicHash>
 #include <QDebug>
 
-#include <KSharedConfig>
-#include <KConfigGroup>
-
 #include "summary.h"
 #include "hardware.h"
 #include "kde.h"
 #include "system.h"
+#include "trace.h"
+#include "state.h"
 
 using namespace KAnalytics;
 
+static const int HARDWARE_BUDGET = 6000; // msec, leaves the rest of Summary::DefaultDeadline to the other collectors
+
 Summary::Summary()
+    : m_uuid(State::instance()->uuid())
 {
-    KSharedConfig::Ptr cfg = KSharedConfig::openConfig("kanalytics");
-    KConfigGroup grp(cfg, "General");
-    const bool hasUuid = grp.hasKey("uuid");
-    if (hasUuid) {
-        //qDebug() << "User has UUID already";
-        m_uuid = grp.readEntry("uuid");
-    } else {
-        //qDebug() << "Creating new UUID";
-        m_uuid = QUuid::createUuid().toString().remove('{').remove('}');
-        grp.writeEntry("uuid", m_uuid);
-    }
 }
 
 Summary::~Summary()
@@ -56,14 +47,70 @@ QString Summary::userUuid() const
     return m_uuid;
 }
 
-QByteArray Summary::toJson() const
+static bool wanted(const QStringList &sections, const char *section)
+{
+    return sections.isEmpty() || sections.contains(QLatin1String(section));
+}
+
+QJsonObject Summary::collect(const Deadline &deadline, const QStringList &sections) const
 {
-    QJsonDocument doc;
+    TraceSpan span("summary", "collect");
     QJsonObject tmpObj;
+    QJsonObject missing;
     tmpObj.insert("uuid", m_uuid);
-    tmpObj.insert("hardware", Hardware().toJson());
-    tmpObj.insert("system", System().toJson());
-    tmpObj.insert("KDE", KDE().toJson());
-    doc.setObject(tmpObj);
-    return doc.toJson();
+
+    if (wanted(sections, "hardware")) {
+        if (deadline.hasExpired()) {
+            missing.insert("hardware", Deadline::reasonString(Deadline::Expired));
+        } else {
+            TraceSpan hwSpan("summary", "hardware");
+            const Deadline hwDeadline(deadline, HARDWARE_BUDGET);
+            tmpObj.insert("hardware", Hardware().toJson(hwDeadline));
+        }
+    }
+
+    // System and KDE only read local files and in-process values, there's nothing
+    // in them a budget could cut short; just don't start them once we're out of time
+    if (wanted(sections, "system")) {
+        if (deadline.hasExpired()) {
+            missing.insert("system", Deadline::reasonString(Deadline::Expired));
+        } else {
+            TraceSpan sysSpan("summary", "system");
+            tmpObj.insert("system", System().toJson());
+        }
+    }
+
+    if (wanted(sections, "KDE")) {
+        if (deadline.hasExpired()) {
+            missing.insert("KDE", Deadline::reasonString(Deadline::Expired));
+        } else {
+            TraceSpan kdeSpan("summary", "KDE");
+            tmpObj.insert("KDE", KDE().toJson());
+        }
+    }
+
+    QJsonObject hashes;
+    const char *hashedSections[] = { "hardware", "system", "KDE" };
+    for (const char *section : hashedSections) {
+        if (tmpObj.contains(section)) {
+            hashes.insert(section, sectionHash(tmpObj.value(section).toObject()));
+        }
+    }
+    tmpObj.insert("sectionHashes", hashes);
+
+    if (!missing.isEmpty()) {
+        tmpObj.insert("missing", missing);
+    }
+    return tmpObj;
+}
+
+QString Summary::sectionHash(const QJsonObject &section)
+{
+    const QByteArray json = QJsonDocument(section).toJson(QJsonDocument::Compact);
+    return QString::fromLatin1(QCryptographicHash::hash(json, QCryptographicHash::Sha1).toHex());
+}
+
+QByteArray Summary::toJson() const
+{
+    return QJsonDocument(collect()).toJson();
 }
@@ -22,9 +22,13 @@
 #define SUMMARY_H
 
 #include <QJsonDocument>
+#include <QJsonObject>
 #include <QString>
+#include <QStringList>
 #include <QNetworkAccessManager>
 
+#include "deadline.h"
+
 namespace KAnalytics {
 
 /**
@@ -46,6 +50,28 @@ public:
      */
     QString userUuid() const;
 
+    /**
+     * Default time limit for collect(), in milliseconds
+     */
+    enum { DefaultDeadline = 10000 };
+
+    /**
+     * Gather basic overall analytics data.
+     *
+     * Collection stops at @p deadline, each collector gets its own share of it.
+     * Sections and probes that didn't make it are listed in the "missing"
+     * objects of the report, mapped to a Deadline::Reason code.
+     *
+     * The "sectionHashes" object maps each collected section to its sectionHash(),
+     * so that the receiving end can store identical sections only once.
+     *
+     * Only the @p sections listed ("hardware", "system", "KDE") are collected,
+     * all of them if it's empty.
+     *
+     * @return Analytics data as a QJsonObject
+     */
+    QJsonObject collect(const Deadline &deadline = Deadline(DefaultDeadline), const QStringList &sections = QStringList()) const;
+
     /**
      * Gather basic overall analytics data.
      *
@@ -53,6 +79,12 @@ public:
      */
     QByteArray toJson() const;
 
+    /**
+     * @return the content hash of a report @p section: the hex SHA-1 of its compact
+     * JSON, which is canonical as QJsonObject keeps its keys sorted
+     */
+    static QString sectionHash(const QJsonObject &section);
+
 private:
     QString m_uuid;
 };
@@ -0,0 +1,91 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <QFile>
+
+#include "sysfs.h"
+#include "backend.h"
+
+using namespace KAnalytics;
+
+static QByteArray readAndClose(int fd, int maxSize)
+{
+    if (fd < 0) {
+        return QByteArray();
+    }
+
+    QByteArray buf(maxSize, Qt::Uninitialized);
+    ssize_t len;
+    do {
+        len = ::read(fd, buf.data(), maxSize);
+    } while (len < 0 && errno == EINTR);
+    ::close(fd);
+
+    if (len <= 0) {
+        return QByteArray();
+    }
+
+    buf.truncate(len);
+    return buf.trimmed();
+}
+
+QString KAnalytics::sysPath(const char *path)
+{
+    return Backend::instance()->rootPath() + QLatin1String(path);
+}
+
+int KAnalytics::openSysDirectory(const char *path)
+{
+    return ::open(QFile::encodeName(sysPath(path)).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+QByteArray KAnalytics::readSysFile(const QString &path, int maxSize)
+{
+    return readAndClose(::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC), maxSize);
+}
+
+QByteArray KAnalytics::readSysFileAt(int dirfd, const char *name, int maxSize)
+{
+    return readAndClose(::openat(dirfd, name, O_RDONLY | O_CLOEXEC), maxSize);
+}
+
+bool KAnalytics::preadFile(int fd, char *buf, size_t size)
+{
+    if (fd < 0) {
+        return false;
+    }
+
+    ssize_t len;
+    do {
+        len = ::pread(fd, buf, size - 1, 0);
+    } while (len < 0 && errno == EINTR);
+
+    if (len <= 0) {
+        return false;
+    }
+
+    buf[len] = '\0';
+    return true;
+}
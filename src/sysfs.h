@@ -0,0 +1,111 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SYSFS_H
+#define SYSFS_H
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <QByteArray>
+#include <QString>
+
+namespace KAnalytics {
+
+/**
+ * @return the absolute @p path (e.g. "/proc/loadavg") in the tree of the current
+ * Backend; unchanged for the running system
+ */
+Q_DECL_EXPORT QString sysPath(const char *path);
+
+/**
+ * @return a file descriptor of the directory @p path in the current Backend's tree,
+ * for readSysFileAt() and forEachSubdirectory(); -1 on error
+ */
+Q_DECL_EXPORT int openSysDirectory(const char *path);
+
+/**
+ * Read a small pseudo-file from sysfs or procfs in one go.
+ *
+ * @return the contents with surrounding whitespace removed, an empty array on error
+ */
+Q_DECL_EXPORT QByteArray readSysFile(const QString &path, int maxSize = 4096);
+
+/**
+ * Same as readSysFile() but relative to the directory @p dirfd, to walk
+ * a subtree without resolving the full path for every file.
+ */
+Q_DECL_EXPORT QByteArray readSysFileAt(int dirfd, const char *name, int maxSize = 4096);
+
+/**
+ * Re-read the already opened pseudo-file @p fd from the start into @p buf,
+ * null-terminated; for files sampled over and over again.
+ *
+ * @return false if @p fd is invalid or the read failed
+ */
+Q_DECL_EXPORT bool preadFile(int fd, char *buf, size_t size);
+
+/**
+ * Call @p func(const char *name) for each entry of @p dirfd whose name starts
+ * with @p prefix, skipping the hidden ones
+ */
+template <typename Func>
+void forEachEntry(int dirfd, const char *prefix, Func func)
+{
+    const int fd = ::openat(dirfd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC); // fdopendir() takes ownership
+    DIR *dir = fd >= 0 ? fdopendir(fd) : 0;
+    if (!dir) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return;
+    }
+
+    const size_t prefixLen = strlen(prefix);
+    while (struct dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] != '.' && !strncmp(entry->d_name, prefix, prefixLen)) {
+            func(entry->d_name);
+        }
+    }
+    closedir(dir);
+}
+
+/**
+ * Call @p func(int fd, const char *name) for each subdirectory of @p dirfd whose
+ * name starts with @p prefix, with @p fd opened on that subdirectory
+ */
+template <typename Func>
+void forEachSubdirectory(int dirfd, const char *prefix, Func func)
+{
+    forEachEntry(dirfd, prefix, [&](const char *name) {
+        const int entryFd = ::openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (entryFd >= 0) {
+            func(entryFd, name);
+            ::close(entryFd);
+        }
+    });
+}
+
+}
+
+#endif // SYSFS_H
@@ -23,12 +23,13 @@
 #include <QMap>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <QGuiApplication>
 
 #include <KF5/plasma/version.h>
 #include <KShell>
 
 #include "system.h"
+#include "trace.h"
+#include "sysfs.h"
 
 static void setVar(QString *var, const QString &value)
 {
@@ -46,10 +47,14 @@ using namespace KAnalytics;
 System::System()
 {
     // set values from uname
-    m_isUtsValid = (uname(&m_utsName) != -1);
+    {
+        TraceSpan span("system", "uname");
+        m_isKernelValid = Backend::instance()->kernel(&m_kernel);
+    }
 
     // parse /etc/os-release
-    QFile file("/etc/os-release");
+    TraceSpan span("system", "os-release");
+    QFile file(sysPath("/etc/os-release"));
     file.open(QIODevice::ReadOnly | QIODevice::Text);
     QString line;
     QStringList comps;
@@ -83,16 +88,16 @@ System::System()
 
 QString System::osName() const
 {
-    if (m_isUtsValid)
-        return m_utsName.sysname;
+    if (m_isKernelValid)
+        return m_kernel.name;
 
     return QString();
 }
 
 QString System::osVersion() const
 {
-    if (m_isUtsValid)
-        return m_utsName.release;
+    if (m_isKernelValid)
+        return m_kernel.release;
 
     return QString();
 }
@@ -117,7 +122,23 @@ QString System::distroVersion() const
 
 QString System::platformName() const
 {
-    return QGuiApplication::platformName();
+    return Backend::instance()->platformName();
+}
+
+Tuning System::tuning() const
+{
+    TraceSpan span("system", "tuning");
+    return detectTuning();
+}
+
+static QJsonObject mapToJson(const QMap<QString, QString> &map)
+{
+    QJsonObject obj;
+    QMap<QString, QString>::const_iterator it;
+    for (it = map.constBegin(); it != map.constEnd(); ++it) {
+        obj.insert(it.key(), it.value());
+    }
+    return obj;
 }
 
 QJsonObject System::toJson() const
@@ -128,5 +149,20 @@ QJsonObject System::toJson() const
     obj.insert("distroName", distroName());
     obj.insert("distroVersion", distroVersion());
     obj.insert("platformName", platformName());
+
+    const Tuning t = tuning();
+    QJsonObject tuningObj;
+    tuningObj.insert("governor", t.governor);
+    tuningObj.insert("epp", t.energyPerformancePreference);
+    tuningObj.insert("thp", t.transparentHugepages);
+    tuningObj.insert("thpDefrag", t.transparentHugepagesDefrag);
+    tuningObj.insert("swappiness", t.swappiness);
+    tuningObj.insert("zswap", t.zswap);
+    tuningObj.insert("zswapCompressor", t.zswapCompressor);
+    tuningObj.insert("zramDevices", t.zramDevices);
+    tuningObj.insert("zramSize", t.zramSize);
+    tuningObj.insert("ioSchedulers", mapToJson(t.ioSchedulers));
+    tuningObj.insert("mitigations", mapToJson(t.mitigations));
+    obj.insert("tuning", tuningObj);
     return obj;
 }
@@ -24,7 +24,8 @@
 #include <QJsonObject>
 #include <QString>
 
-#include <sys/utsname.h>
+#include "backend.h"
+#include "tuning.h"
 
 namespace KAnalytics {
 
@@ -59,17 +60,25 @@ public:
     QString distroVersion() const;
 
     /**
-     * @return Name of the underlying platform plugin (e.g. xcb, windows or ios)
+     * @return Name of the underlying platform plugin (e.g. xcb, windows or ios),
+     * empty if not running in a QGuiApplication
      */
     QString platformName() const;
 
+    /**
+     * @return the performance-related kernel tunables: cpufreq governor and EPP,
+     * transparent huge pages, swappiness, zram/zswap, I/O schedulers and CPU
+     * vulnerability mitigations
+     */
+    Tuning tuning() const;
+
     /**
      * @return System information analytics data as a QJsonObject
      */
     QJsonObject toJson() const;
 private:
-    bool m_isUtsValid;
-    struct utsname m_utsName;
+    bool m_isKernelValid;
+    KernelInfo m_kernel;
     QString m_distroName;
     QString m_distroVersion;
 };
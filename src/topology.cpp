@@ -0,0 +1,123 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <stdlib.h>
+
+#include <QSet>
+
+#include "topology.h"
+#include "sysfs.h"
+
+using namespace KAnalytics;
+
+// sysfs sizes look like "48K", "2048K" or "32M"
+static qint64 parseSize(const QByteArray &value)
+{
+    if (value.isEmpty()) {
+        return 0;
+    }
+
+    qint64 size = value.toLongLong();
+    if (!size) {
+        size = value.left(value.size() - 1).toLongLong();
+        switch (value.at(value.size() - 1)) {
+        case 'K':
+            size *= 1024;
+            break;
+        case 'M':
+            size *= 1024 * 1024;
+            break;
+        case 'G':
+            size *= 1024 * 1024 * 1024;
+            break;
+        }
+    }
+    return size;
+}
+
+Topology KAnalytics::detectTopology()
+{
+    Topology topology;
+    topology.sockets = 0;
+    topology.cores = 0;
+    topology.threads = 0;
+    topology.smt = false;
+
+    const int cpuFd = openSysDirectory("/sys/devices/system/cpu");
+    if (cpuFd >= 0) {
+        QSet<int> packages;
+        QSet<QPair<int, int> > cores;
+        forEachSubdirectory(cpuFd, "cpu", [&](int fd, const char *) {
+            // offline CPUs have no topology directory, cpu0 often has no "online" file
+            const QByteArray package = readSysFileAt(fd, "topology/physical_package_id");
+            if (package.isEmpty() || readSysFileAt(fd, "online") == "0") {
+                return;
+            }
+            ++topology.threads;
+            packages.insert(package.toInt());
+            cores.insert(qMakePair(package.toInt(), readSysFileAt(fd, "topology/core_id").toInt()));
+        });
+        topology.sockets = packages.size();
+        topology.cores = cores.size();
+
+        const QByteArray smt = readSysFileAt(cpuFd, "smt/active"); // Linux 4.19+
+        topology.smt = smt.isEmpty() ? topology.threads > topology.cores : smt == "1";
+
+        const int cacheFd = ::openat(cpuFd, "cpu0/cache", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (cacheFd >= 0) {
+            forEachSubdirectory(cacheFd, "index", [&](int fd, const char *) {
+                CpuCache cache;
+                cache.level = readSysFileAt(fd, "level").toInt();
+                cache.type = QString::fromLatin1(readSysFileAt(fd, "type"));
+                cache.size = parseSize(readSysFileAt(fd, "size"));
+                topology.caches.append(cache);
+            });
+            ::close(cacheFd);
+        }
+        ::close(cpuFd);
+    }
+
+    const int nodeFd = openSysDirectory("/sys/devices/system/node");
+    if (nodeFd >= 0) {
+        QMap<int, qint64> nodes; // readdir() order is arbitrary
+        forEachSubdirectory(nodeFd, "node", [&](int fd, const char *name) {
+            // "Node 0 MemTotal:        4816632 kB"
+            const QByteArray meminfo = readSysFileAt(fd, "meminfo", 256);
+            const int pos = meminfo.indexOf("MemTotal:");
+            if (pos >= 0) {
+                nodes.insert(atoi(name + 4), meminfo.mid(pos + 9, meminfo.indexOf('\n', pos) - pos - 9).simplified().split(' ').first().toLongLong() * 1024);
+            }
+        });
+        topology.nodeMemory = nodes.values();
+        ::close(nodeFd);
+    }
+
+    const int hugeFd = openSysDirectory("/sys/kernel/mm/hugepages");
+    if (hugeFd >= 0) {
+        // "hugepages-2048kB"
+        forEachSubdirectory(hugeFd, "hugepages-", [&](int fd, const char *name) {
+            topology.hugepages.insert(qint64(atoll(name + 10)) * 1024, readSysFileAt(fd, "nr_hugepages").toInt());
+        });
+        ::close(hugeFd);
+    }
+
+    return topology;
+}
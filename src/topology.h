@@ -0,0 +1,61 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <QList>
+#include <QMap>
+#include <QString>
+
+namespace KAnalytics {
+
+/**
+ * CPU cache as seen by the first CPU
+ */
+struct CpuCache {
+    int level;    ///< 1, 2, 3...
+    QString type; ///< "Data", "Instruction" or "Unified"
+    qint64 size;  ///< in bytes
+};
+
+/**
+ * Memory hierarchy and NUMA topology of the machine
+ */
+struct Topology {
+    int sockets;              ///< physical packages
+    int cores;                ///< physical cores, over all the packages
+    int threads;              ///< online logical CPUs
+    bool smt;                 ///< whether simultaneous multithreading is active
+    QList<CpuCache> caches;   ///< the caches of CPU 0, one per level and type
+    QList<qint64> nodeMemory; ///< total memory of each NUMA node, in bytes
+    QMap<qint64, int> hugepages; ///< page size in bytes -> number of reserved huge pages
+};
+
+/**
+ * @return the topology read from /sys/devices/system/cpu, /sys/devices/system/node
+ * and /sys/kernel/mm/hugepages in one pass; counts are 0 where sysfs has no data
+ */
+Q_DECL_EXPORT Topology detectTopology();
+
+}
+
+#endif // TOPOLOGY_H
@@ -0,0 +1,147 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QCoreApplication>
+#include <QThread>
+
+#include "trace.h"
+
+using namespace KAnalytics;
+
+static Trace *s_current = 0;
+static Trace::AllocationCounter s_allocationCounter = 0;
+
+Trace::Trace()
+    : m_previous(s_current)
+{
+    m_clock.start();
+    s_current = this;
+}
+
+Trace::~Trace()
+{
+    s_current = m_previous;
+}
+
+Trace *Trace::current()
+{
+    return s_current;
+}
+
+void Trace::setAllocationCounter(AllocationCounter counter)
+{
+    s_allocationCounter = counter;
+}
+
+Trace::AllocationCounter Trace::allocationCounter()
+{
+    return s_allocationCounter;
+}
+
+qint64 Trace::elapsed() const
+{
+    return m_clock.nsecsElapsed() / 1000;
+}
+
+void Trace::addEvent(const Event &event)
+{
+    m_events.append(event);
+}
+
+QList<Trace::Event> Trace::events() const
+{
+    return m_events;
+}
+
+QByteArray Trace::toChromeTrace() const
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+    const qint64 tid = reinterpret_cast<quintptr>(QThread::currentThreadId());
+
+    QJsonArray traceEvents;
+    foreach (const Event &event, m_events) {
+        QJsonObject obj;
+        obj.insert("name", QLatin1String(event.name));
+        obj.insert("cat", QLatin1String(event.category));
+        obj.insert("ph", QStringLiteral("X")); // complete event, has both ts and dur
+        obj.insert("ts", event.start);
+        obj.insert("dur", event.duration);
+        obj.insert("pid", pid);
+        obj.insert("tid", tid);
+        if (event.allocations >= 0) {
+            QJsonObject args;
+            args.insert("allocations", event.allocations);
+            obj.insert("args", args);
+        }
+        traceEvents.append(obj);
+    }
+
+    QJsonObject doc;
+    doc.insert("traceEvents", traceEvents);
+    doc.insert("displayTimeUnit", QStringLiteral("ms"));
+    return QJsonDocument(doc).toJson(QJsonDocument::Compact);
+}
+
+QJsonObject Trace::toStats() const
+{
+    QJsonObject spans;
+    foreach (const Event &event, m_events) {
+        QJsonObject obj;
+        obj.insert("duration", event.duration);
+        if (event.allocations >= 0) {
+            obj.insert("allocations", event.allocations);
+        }
+        spans.insert(QStringLiteral("%1/%2").arg(QLatin1String(event.category), QLatin1String(event.name)), obj);
+    }
+
+    QJsonObject stats;
+    stats.insert("total", elapsed());
+    stats.insert("spans", spans);
+    return stats;
+}
+
+TraceSpan::TraceSpan(const char *category, const char *name)
+    : m_trace(s_current), m_category(category), m_name(name), m_start(0), m_allocations(0)
+{
+    if (m_trace) {
+        m_start = m_trace->elapsed();
+        if (s_allocationCounter) {
+            m_allocations = s_allocationCounter();
+        }
+    }
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (!m_trace) {
+        return;
+    }
+
+    Trace::Event event;
+    event.category = m_category;
+    event.name = m_name;
+    event.start = m_start;
+    event.duration = m_trace->elapsed() - m_start;
+    event.allocations = s_allocationCounter ? qint64(s_allocationCounter() - m_allocations) : -1;
+    m_trace->addEvent(event);
+}
@@ -0,0 +1,143 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QList>
+
+namespace KAnalytics {
+
+/**
+ * Collection trace
+ *
+ * Records how long the collectors and their probes take. While a Trace object
+ * exists it is the current one and every TraceSpan created meanwhile is recorded
+ * into it; without a Trace spans cost a single pointer check.
+ *
+ * Traces are meant to wrap a collection running on one thread, they are not
+ * thread-safe.
+ */
+class Q_DECL_EXPORT Trace
+{
+public:
+    /**
+     * A finished span, times are in microseconds since the trace started
+     */
+    struct Event {
+        const char *category;
+        const char *name;
+        qint64 start;
+        qint64 duration;
+        qint64 allocations; ///< -1 if no allocation counter is installed
+    };
+
+    /**
+     * A function returning the number of heap allocations made by the process so far
+     */
+    typedef quint64 (*AllocationCounter)();
+
+    /**
+     * Start a trace and make it the current one
+     */
+    Trace();
+
+    /**
+     * Stop the trace, the previously current trace (if any) becomes current again
+     */
+    ~Trace();
+
+    /**
+     * @return the current trace, or 0 if nothing is being traced
+     */
+    static Trace *current();
+
+    /**
+     * Install the @p counter spans use to count allocations; the library can't
+     * count them itself, only the application can replace operator new.
+     */
+    static void setAllocationCounter(AllocationCounter counter);
+
+    /**
+     * @return the installed allocation counter, or 0
+     */
+    static AllocationCounter allocationCounter();
+
+    /**
+     * @return microseconds elapsed since the trace started
+     */
+    qint64 elapsed() const;
+
+    /**
+     * Record a finished span
+     */
+    void addEvent(const Event &event);
+
+    /**
+     * @return the recorded spans in the order they finished
+     */
+    QList<Event> events() const;
+
+    /**
+     * @return the trace in the Chrome trace event format, loadable in chrome://tracing
+     */
+    QByteArray toChromeTrace() const;
+
+    /**
+     * @return a summary of the trace: the total time and the duration and
+     * allocations of each span, keyed by "category/name"
+     */
+    QJsonObject toStats() const;
+
+private:
+    Q_DISABLE_COPY(Trace)
+    QElapsedTimer m_clock;
+    QList<Event> m_events;
+    Trace *m_previous;
+};
+
+/**
+ * Traced scope
+ *
+ * Records the time between its construction and destruction into the current Trace.
+ * @p category and @p name must be string literals, they are stored as pointers.
+ */
+class Q_DECL_EXPORT TraceSpan
+{
+public:
+    TraceSpan(const char *category, const char *name);
+    ~TraceSpan();
+
+private:
+    Q_DISABLE_COPY(TraceSpan)
+    Trace *m_trace;
+    const char *m_category;
+    const char *m_name;
+    qint64 m_start;
+    quint64 m_allocations;
+};
+
+}
+
+#endif // TRACE_H
@@ -0,0 +1,99 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "tuning.h"
+#include "sysfs.h"
+
+using namespace KAnalytics;
+
+// "always [madvise] never" -> "madvise"; values without a choice are returned as is
+static QString selected(const QByteArray &value)
+{
+    const int start = value.indexOf('[');
+    const int end = value.indexOf(']', start);
+    if (start < 0 || end < 0) {
+        return QString::fromLatin1(value);
+    }
+
+    return QString::fromLatin1(value.mid(start + 1, end - start - 1));
+}
+
+Tuning KAnalytics::detectTuning()
+{
+    Tuning tuning;
+    tuning.swappiness = -1;
+    tuning.zswap = false;
+    tuning.zramDevices = 0;
+    tuning.zramSize = 0;
+
+    const int procSysFd = openSysDirectory("/proc/sys");
+    if (procSysFd >= 0) {
+        const QByteArray swappiness = readSysFileAt(procSysFd, "vm/swappiness");
+        if (!swappiness.isEmpty()) {
+            tuning.swappiness = swappiness.toInt();
+        }
+        ::close(procSysFd);
+    }
+
+    const int sysFd = openSysDirectory("/sys");
+    if (sysFd < 0) {
+        return tuning;
+    }
+
+    tuning.governor = QString::fromLatin1(readSysFileAt(sysFd, "devices/system/cpu/cpu0/cpufreq/scaling_governor"));
+    tuning.energyPerformancePreference = QString::fromLatin1(readSysFileAt(sysFd, "devices/system/cpu/cpu0/cpufreq/energy_performance_preference"));
+    tuning.transparentHugepages = selected(readSysFileAt(sysFd, "kernel/mm/transparent_hugepage/enabled"));
+    tuning.transparentHugepagesDefrag = selected(readSysFileAt(sysFd, "kernel/mm/transparent_hugepage/defrag"));
+    tuning.zswap = readSysFileAt(sysFd, "module/zswap/parameters/enabled") == "Y";
+    tuning.zswapCompressor = QString::fromLatin1(readSysFileAt(sysFd, "module/zswap/parameters/compressor"));
+
+    const int blockFd = ::openat(sysFd, "block", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (blockFd >= 0) {
+        forEachSubdirectory(blockFd, "", [&](int fd, const char *name) {
+            const QByteArray device(name);
+            if (device.startsWith("zram")) {
+                ++tuning.zramDevices;
+                tuning.zramSize += readSysFileAt(fd, "disksize").toLongLong();
+            } else if (!device.startsWith("loop") && !device.startsWith("ram")) {
+                const QByteArray scheduler = readSysFileAt(fd, "queue/scheduler");
+                if (!scheduler.isEmpty()) {
+                    tuning.ioSchedulers.insert(QString::fromLatin1(device), selected(scheduler));
+                }
+            }
+        });
+        ::close(blockFd);
+    }
+
+    // these are files, not directories
+    const int vulnFd = ::openat(sysFd, "devices/system/cpu/vulnerabilities", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (vulnFd >= 0) {
+        forEachEntry(vulnFd, "", [&](const char *name) {
+            tuning.mitigations.insert(QString::fromLatin1(name), QString::fromLatin1(readSysFileAt(vulnFd, name, 256)));
+        });
+        ::close(vulnFd);
+    }
+
+    ::close(sysFd);
+    return tuning;
+}
@@ -0,0 +1,54 @@
+/*
+    Copyright 2014 Lukáš Tinkl <lukas@kde.org>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef TUNING_H
+#define TUNING_H
+
+#include <QMap>
+#include <QString>
+
+namespace KAnalytics {
+
+/**
+ * Kernel tunables that commonly affect desktop performance
+ */
+struct Tuning {
+    QString governor;                    ///< cpufreq governor of CPU 0, e.g. "powersave"
+    QString energyPerformancePreference; ///< EPP of CPU 0, e.g. "balance_performance"
+    QString transparentHugepages;        ///< THP mode: "always", "madvise" or "never"
+    QString transparentHugepagesDefrag;  ///< THP defrag mode
+    int swappiness;                      ///< vm.swappiness, -1 if unknown
+    bool zswap;                          ///< whether zswap is enabled
+    QString zswapCompressor;             ///< zswap compression algorithm
+    int zramDevices;                     ///< number of zram devices
+    qint64 zramSize;                     ///< total size of the zram devices, in bytes
+    QMap<QString, QString> ioSchedulers; ///< block device -> active I/O scheduler
+    QMap<QString, QString> mitigations;  ///< CPU vulnerability -> mitigation status
+};
+
+/**
+ * @return the tunables, read from /sys and /proc/sys through one directory fd each
+ */
+Tuning detectTuning();
+
+}
+
+#endif // TUNING_H
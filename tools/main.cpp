@@ -18,14 +18,23 @@
 
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
 
 #include <QProcess>
 #include <QDebug>
 #include <QCommandLineParser>
 #include <QTextStream>
-#include <QApplication>
+#include <QCoreApplication>
+#include <QGuiApplication>
 #include <QJsonDocument>
 #include <QDBusInterface>
+#include <QFile>
+#include <QScopedPointer>
+#include <QDateTime>
+#include <QTimer>
 
 #include <KAboutData>
 #include <KLocalizedString>
@@ -35,6 +44,9 @@
 #include "hardware.h"
 #include "kde.h"
 #include "summary.h"
+#include "trace.h"
+#include "sampler.h"
+#include "backend.h"
 
 #define TAB "\t"
 
@@ -42,11 +54,35 @@ using namespace std;
 
 static QTextStream out(stdout);
 
+// count heap allocations for --trace, the library can't do that on its own
+static std::atomic<quint64> s_allocations(0);
+
+void *operator new(std::size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr) {
+        abort(); // built without exceptions, no std::bad_alloc
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+static quint64 allocationCount()
+{
+    return s_allocations.load(std::memory_order_relaxed);
+}
+
 void showCommands()
 {
     out << "Commands: " << endl;
     out << TAB << "dump" << TAB << "Dump various information about this system" << endl;
     out << TAB << TAB << "Possible arguments include: all, system, hardware, kde" << endl;
+    out << TAB << TAB << "With --watch, keeps running and prints the changing values every <seconds> as NDJSON" << endl;
     out << TAB << "export" << TAB << "Export and upload overall analytics data about this system to a KDE server" << endl;
 }
 
@@ -67,6 +103,11 @@ void dumpSystemInfo(bool json) {
         out << TAB << "Distro name: " << sys.distroName() << endl;
         out << TAB << "Distro version: " << sys.distroVersion() << endl;
         out << TAB << "Platform plugin name: " << sys.platformName() << endl;
+        const KAnalytics::Tuning tuning = sys.tuning();
+        out << TAB << "CPU governor: " << tuning.governor << endl;
+        out << TAB << "Transparent huge pages: " << tuning.transparentHugepages << endl;
+        out << TAB << "Swappiness: " << tuning.swappiness << endl;
+        out << TAB << "zswap: " << tuning.zswap << ", zram devices: " << tuning.zramDevices << endl;
     }
 }
 
@@ -84,10 +125,27 @@ void dumpHwInfo(bool json) {
         out << TAB << "CPU vendor: " << hw.cpuVendor() << endl;
         out << TAB << "CPU model: " << hw.cpuModel() << endl;
         out << TAB << "CPU speed: " << hw.cpuSpeed() << " MHz" << endl;
+        out << TAB << "CPU level: " << hw.cpuLevel() << endl;
+        out << TAB << "CPU features: " << hw.cpuFeatures().join(QLatin1Char(' ')) << endl;
         out << TAB << "Total RAM: " << KFormat().formatByteSize(hw.totalRam()) << endl;
+        const KAnalytics::Topology topology = hw.topology();
+        out << TAB << "Sockets/cores/threads: " << topology.sockets << "/" << topology.cores << "/" << topology.threads
+            << (topology.smt ? " (SMT)" : "") << endl;
+        foreach (const KAnalytics::CpuCache &cache, topology.caches) {
+            out << TAB << "L" << cache.level << " " << cache.type << " cache: " << KFormat().formatByteSize(cache.size) << endl;
+        }
+        out << TAB << "NUMA nodes: " << topology.nodeMemory.count() << endl;
+        foreach (const KAnalytics::DrmGpu &gpu, hw.gpus()) {
+            out << TAB << "GPU: " << QStringLiteral("%1 [%2:%3], driver %4").arg(gpu.vendor.isEmpty() ? i18n("Unknown vendor") : gpu.vendor)
+                   .arg(gpu.vendorId, 4, 16, QLatin1Char('0')).arg(gpu.deviceId, 4, 16, QLatin1Char('0')).arg(gpu.driver);
+            if (gpu.vram > 0) {
+                out << ", VRAM " << KFormat().formatByteSize(gpu.vram);
+            }
+            out << endl;
+        }
         out << TAB << "Has HDD: " << hw.hasHdd() << endl;
         out << TAB << "Has SSD: " << hw.hasSsd() << endl;
-        out << TAB << "Logical screen DPI: " << hw.screenDpi() << endl;
+        out << TAB << (hw.isScreenDpiPhysical() ? "Physical screen DPI (EDID): " : "Logical screen DPI: ") << hw.screenDpi() << endl;
         const QSize res = hw.screenResolution();
         out << TAB << "Screen resolution: " << QStringLiteral("%1x%2").arg(res.width()).arg(res.height()) << endl;
         const QSizeF size = hw.screenSize();
@@ -123,15 +181,99 @@ void dumpAll(bool json) {
     }
 }
 
+QJsonObject collect(const QString &subcommand) {
+    if (subcommand == "system") {
+        return KAnalytics::System().toJson();
+    } else if (subcommand == "hardware") {
+        return KAnalytics::Hardware().toJson();
+    } else if (subcommand == "kde") {
+        return KAnalytics::KDE().toJson();
+    }
+    return KAnalytics::Summary().collect();
+}
+
+// One compact object per line; QJsonObject keeps its keys sorted, so the field order
+// is the same in every record. endl flushes, each record reaches the pipe right away
+void writeRecord(const QJsonObject &record) {
+    out << QJsonDocument(record).toJson(QJsonDocument::Compact) << endl;
+}
+
+bool writeTrace(const KAnalytics::Trace &trace, const QString &fileName) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Cannot write the trace to" << fileName << ":" << file.errorString();
+        return false;
+    }
+    file.write(trace.toChromeTrace());
+    return true;
+}
+
+// Static data is written once, then only the sampled values are re-read; the process
+// stays resident, so the /proc files are opened once and each record costs a few preads.
+// The @p trace only covers that one collection, so it's written right after it rather
+// than on quit: watching usually ends with Ctrl+C, which never returns from exec()
+int watch(const QString &subcommand, int seconds, bool changesOnly, const KAnalytics::Trace *trace, const QString &traceFile) {
+    QJsonObject report;
+    report.insert("type", QStringLiteral("report"));
+    report.insert("time", double(QDateTime::currentMSecsSinceEpoch()));
+    report.insert("report", collect(subcommand));
+    writeRecord(report);
+
+    if (trace && !writeTrace(*trace, traceFile)) {
+        return 1;
+    }
+
+    KAnalytics::Sampler sampler;
+    QJsonObject last;
+    QTimer timer;
+    QObject::connect(&timer, &QTimer::timeout, [&sampler, &last, changesOnly]() {
+        const QJsonObject values = KAnalytics::Sampler::sampleToJson(sampler.sample());
+
+        QJsonObject record;
+        for (QJsonObject::const_iterator it = values.constBegin(); it != values.constEnd(); ++it) {
+            if (!changesOnly || last.value(it.key()) != it.value()) {
+                record.insert(it.key(), it.value());
+            }
+        }
+        last = values;
+
+        if (changesOnly && record.isEmpty()) {
+            return;
+        }
+        record.insert("type", QStringLiteral("sample"));
+        record.insert("time", double(QDateTime::currentMSecsSinceEpoch()));
+        writeRecord(record);
+    });
+    timer.start(seconds * 1000);
+
+    return qApp->exec();
+}
+
 void exportData() {
     QDBusInterface iface("org.kde.kded5", "/modules/kanalytics", "org.kde.analytics");
     QDBusConnection::sessionBus().connect(iface.service(), iface.path(), iface.interface(), "exportFinished", qApp, SLOT(quit()));
     iface.call("exportData");
 }
 
+// A GUI application only when there's a display to talk to, the collectors fall back
+// to sysfs otherwise; this also saves loading a platform plugin when running from cron
+QCoreApplication *createApplication(int &argc, char *argv[])
+{
+    bool headless = qEnvironmentVariableIsEmpty("DISPLAY") && qEnvironmentVariableIsEmpty("WAYLAND_DISPLAY");
+    for (int i = 1; i < argc && !headless; ++i) {
+        headless = !qstrcmp(argv[i], "--headless");
+    }
+
+    if (headless) {
+        return new QCoreApplication(argc, argv);
+    }
+    return new QGuiApplication(argc, argv);
+}
+
 int main (int argc, char *argv[])
 {
-    QApplication app(argc, argv);
+    QScopedPointer<QCoreApplication> appPtr(createApplication(argc, argv));
+    QCoreApplication &app = *appPtr;
     KAboutData aboutData("kanalytics-console", i18n("KAnalytics Console Application"), "1.0",
                          i18n("Console app to inspect KAnalytics data"),
                          KAboutLicense::GPL, i18n("(c) 2014 KAnalytics Team"));
@@ -144,7 +286,13 @@ int main (int argc, char *argv[])
     parser.addVersionOption();
     parser.addOption(QCommandLineOption("commands", i18n("List the available commands")));
     parser.addOption(QCommandLineOption("json", i18n("Dump data in JSON format")));
+    parser.addOption(QCommandLineOption("format", i18n("Output format of dump: text, json or ndjson (one compact record per line)"), "format", "text"));
+    parser.addOption(QCommandLineOption("watch", i18n("Keep running and print the changing values every <seconds>, implies --format=ndjson"), "seconds"));
+    parser.addOption(QCommandLineOption("changes", i18n("With --watch, only print the values that changed since the previous record")));
     parser.addOption(QCommandLineOption("uuid", i18n("Show the user UUID")));
+    parser.addOption(QCommandLineOption("headless", i18n("Collect without connecting to the display server, read screen data from sysfs")));
+    parser.addOption(QCommandLineOption("trace", i18n("Write collection timings to <file> in the Chrome trace event format"), "file"));
+    parser.addOption(QCommandLineOption("fixture", i18n("Collect from the machine recorded in <directory> instead of this one"), "directory"));
     parser.addPositionalArgument("command", i18n("Command to execute"));
     parser.addPositionalArgument("[args...]", i18n("Arguments for the specified command"));
 
@@ -152,6 +300,15 @@ int main (int argc, char *argv[])
     parser.process(app);
     aboutData.processCommandLine(&parser);
 
+    if (parser.isSet("fixture")) {
+        KAnalytics::FixtureBackend *fixture = new KAnalytics::FixtureBackend(parser.value("fixture"));
+        if (!fixture->isValid()) {
+            delete fixture;
+            return 1;
+        }
+        KAnalytics::Backend::setInstance(fixture);
+    }
+
     // uuid
     if (parser.isSet("uuid")) {
         showUuid();
@@ -171,28 +328,52 @@ int main (int argc, char *argv[])
         return 1;
     }
 
-    const bool toJson = parser.isSet("json");
+    const QString format = parser.isSet("watch") ? QStringLiteral("ndjson") : parser.value("format");
+    if (format != "text" && format != "json" && format != "ndjson") {
+        qWarning() << "Unsupported format" << format;
+        return 1;
+    }
+    const bool toJson = parser.isSet("json") || format == "json";
 
     if (command == "dump") {
+        QScopedPointer<KAnalytics::Trace> trace;
+        if (parser.isSet("trace")) {
+            KAnalytics::Trace::setAllocationCounter(allocationCount);
+            trace.reset(new KAnalytics::Trace);
+        }
+
         const QString subcommand = parser.positionalArguments().value(1);
         //qDebug() << "SUBCOMMAND:" << command;
-        if (subcommand == "system") {
+        if (subcommand != "system" && subcommand != "hardware" && subcommand != "kde" && subcommand != "all") {
+            qWarning() << "Unsupported argument for the <dump> command";
+            showCommands();
+            return 1;
+        }
+
+        if (parser.isSet("watch")) {
+            bool ok;
+            const int seconds = parser.value("watch").toInt(&ok);
+            if (!ok || seconds < 1) {
+                qWarning() << "The watch interval has to be a positive number of seconds";
+                return 1;
+            }
+            return watch(subcommand, seconds, parser.isSet("changes"), trace.data(), parser.value("trace"));
+        } else if (format == "ndjson") {
+            writeRecord(collect(subcommand));
+        } else if (subcommand == "system") {
             dumpSystemInfo(toJson);
-            return 0;
         } else if (subcommand == "hardware") {
             dumpHwInfo(toJson);
-            return 0;
         } else if (subcommand == "kde") {
             dumpKdeInfo(toJson);
-            return 0;
-        } else if (subcommand == "all") {
-            dumpAll(toJson);
-            return 0;
         } else {
-            qWarning() << "Unsupported argument for the <dump> command";
-            showCommands();
+            dumpAll(toJson);
+        }
+
+        if (trace && !writeTrace(*trace, parser.value("trace"))) {
             return 1;
         }
+        return 0;
     } else if (command == "export") {
         exportData();
         return app.exec();